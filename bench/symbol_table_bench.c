@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Microbenchmark da tabela de símbolos: compara a tabela com endereçamento
+ * aberto (src/symbol_table.c) com a antiga tabela encadeada de 211 listas e
+ * um malloc por símbolo, reproduzida abaixo.
+ *
+ * Para cada tamanho, declara N nomes em um escopo global e N/8 em um escopo
+ * filho, depois faz consultas a partir do escopo filho: nomes do próprio
+ * escopo, nomes encontrados no pai e nomes inexistentes.
+ *
+ * Uso: symbol_table_bench [rodadas]
+ */
+
+#include "symbol_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* ---------------------------------------------------------------------------
+ * Tabela antiga: 211 listas encadeadas, hash name % size
+ * ------------------------------------------------------------------------ */
+
+typedef struct ChainedSymbol {
+    Atom name;
+    void *value;
+    struct ChainedSymbol *next;
+} ChainedSymbol;
+
+typedef struct ChainedTable {
+    ChainedSymbol **symbols;
+    int size;
+    struct ChainedTable *parent;
+} ChainedTable;
+
+static ChainedTable *chained_create(ChainedTable *parent) {
+    ChainedTable *table = malloc(sizeof(ChainedTable));
+    table->size = 211;
+    table->symbols = calloc(table->size, sizeof(ChainedSymbol *));
+    if (!table->symbols) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    table->parent = parent;
+    return table;
+}
+
+static void chained_insert(ChainedTable *table, Atom name, void *value) {
+    unsigned int index = name % table->size;
+    ChainedSymbol *symbol = malloc(sizeof(ChainedSymbol));
+    if (!symbol) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    symbol->name = name;
+    symbol->value = value;
+    symbol->next = table->symbols[index];
+    table->symbols[index] = symbol;
+}
+
+static void *chained_lookup(ChainedTable *table, Atom name) {
+    for (; table; table = table->parent) {
+        for (ChainedSymbol *symbol = table->symbols[name % table->size]; symbol; symbol = symbol->next) {
+            if (symbol->name == name) {
+                return symbol->value;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void chained_free(ChainedTable *table) {
+    for (int i = 0; i < table->size; i++) {
+        ChainedSymbol *symbol = table->symbols[i];
+        while (symbol) {
+            ChainedSymbol *next = symbol->next;
+            free(symbol);
+            symbol = next;
+        }
+    }
+    free(table->symbols);
+    free(table);
+}
+
+/* ---------------------------------------------------------------------------
+ * Medição
+ * ------------------------------------------------------------------------ */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Embaralha os átomos 1..count (os nomes de um programa não chegam em ordem)
+static Atom *shuffled_atoms(size_t count, unsigned int seed) {
+    Atom *atoms = malloc(count * sizeof(Atom));
+    if (!atoms) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        atoms[i] = (Atom)(i + 1);
+    }
+    for (size_t i = count - 1; i > 0; i--) {
+        seed = seed * 1103515245u + 12345u;
+        size_t j = seed % (i + 1);
+        Atom tmp = atoms[i];
+        atoms[i] = atoms[j];
+        atoms[j] = tmp;
+    }
+    return atoms;
+}
+
+typedef struct {
+    double insert;
+    double lookup;
+    size_t found;
+} BenchResult;
+
+static BenchResult bench_open(const Atom *atoms, size_t globals, size_t locals, const Atom *queries, size_t query_count) {
+    BenchResult result = {0, 0, 0};
+    SymbolTable global, local;
+    double start = now_seconds();
+    symbol_table_init(&global, NULL);
+    symbol_table_init(&local, &global);
+    for (size_t i = 0; i < globals; i++) {
+        symbol_table_insert(&global, atoms[i], (void *)&atoms[i]);
+    }
+    for (size_t i = 0; i < locals; i++) {
+        symbol_table_insert(&local, atoms[globals + i], (void *)&atoms[globals + i]);
+    }
+    double middle = now_seconds();
+    for (size_t i = 0; i < query_count; i++) {
+        result.found += symbol_table_lookup(&local, queries[i]) != NULL;
+    }
+    double end = now_seconds();
+    symbol_table_free(&local);
+    symbol_table_free(&global);
+    result.insert = middle - start;
+    result.lookup = end - middle;
+    return result;
+}
+
+static BenchResult bench_chained(const Atom *atoms, size_t globals, size_t locals, const Atom *queries, size_t query_count) {
+    BenchResult result = {0, 0, 0};
+    double start = now_seconds();
+    ChainedTable *global = chained_create(NULL);
+    ChainedTable *local = chained_create(global);
+    for (size_t i = 0; i < globals; i++) {
+        chained_insert(global, atoms[i], (void *)&atoms[i]);
+    }
+    for (size_t i = 0; i < locals; i++) {
+        chained_insert(local, atoms[globals + i], (void *)&atoms[globals + i]);
+    }
+    double middle = now_seconds();
+    for (size_t i = 0; i < query_count; i++) {
+        result.found += chained_lookup(local, queries[i]) != NULL;
+    }
+    double end = now_seconds();
+    chained_free(local);
+    chained_free(global);
+    result.insert = middle - start;
+    result.lookup = end - middle;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 5;
+    if (rounds < 1) {
+        rounds = 1;
+    }
+    static const size_t sizes[] = { 64, 1024, 16384 };
+    const size_t query_count = 1u << 20;
+
+    printf("%10s %12s %14s %14s %14s %14s %8s\n", "nomes", "consultas",
+           "enc. inserção", "enc. consulta", "RH inserção", "RH consulta", "ganho");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t globals = sizes[s];
+        size_t locals = globals / 8;
+        size_t total = globals + locals;
+
+        // Metade dos nomes consultados existe; a outra metade nunca foi declarada
+        Atom *atoms = shuffled_atoms(total * 2, 42u + (unsigned int)s);
+        Atom *queries = malloc(query_count * sizeof(Atom));
+        if (!queries) {
+            perror("Erro de alocação de memória");
+            return 1;
+        }
+        unsigned int seed = 7u;
+        for (size_t i = 0; i < query_count; i++) {
+            seed = seed * 1103515245u + 12345u;
+            queries[i] = atoms[(seed >> 8) % (total * 2)];
+        }
+
+        BenchResult best_chained = {1e30, 1e30, 0};
+        BenchResult best_open = {1e30, 1e30, 0};
+        for (int r = 0; r < rounds; r++) {
+            BenchResult c = bench_chained(atoms, globals, locals, queries, query_count);
+            BenchResult o = bench_open(atoms, globals, locals, queries, query_count);
+            if (c.found != o.found) {
+                fprintf(stderr, "Resultados divergentes: %zu != %zu\n", c.found, o.found);
+                return 1;
+            }
+            if (c.insert < best_chained.insert) best_chained.insert = c.insert;
+            if (c.lookup < best_chained.lookup) best_chained.lookup = c.lookup;
+            if (o.insert < best_open.insert) best_open.insert = o.insert;
+            if (o.lookup < best_open.lookup) best_open.lookup = o.lookup;
+        }
+
+        printf("%10zu %12zu %11.3f ms %11.3f ms %11.3f ms %11.3f ms %7.1fx\n", total, query_count,
+               best_chained.insert * 1e3, best_chained.lookup * 1e3,
+               best_open.insert * 1e3, best_open.lookup * 1e3,
+               best_open.lookup > 0 ? best_chained.lookup / best_open.lookup : 0.0);
+        free(queries);
+        free(atoms);
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Alocador por região (bump allocator).
+ *
+ * A memória é cortada sequencialmente de blocos grandes e só é devolvida de
+ * uma vez, em arena_release. Serve para objetos que vivem tanto quanto a
+ * compilação, como os nós da AST.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;        // Bloco atual (os anteriores seguem por next)
+    size_t chunk_size;       // Tamanho padrão de um novo bloco
+    size_t bytes_allocated;  // Total pedido ao sistema
+} Arena;
+
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ * Inicializa uma arena vazia.
+ *
+ * @param arena Arena a inicializar.
+ * @param chunk_size Tamanho dos blocos (0 usa ARENA_DEFAULT_CHUNK_SIZE).
+ */
+void arena_init(Arena *arena, size_t chunk_size);
+
+/**
+ * Reserva size bytes alinhados na arena.
+ *
+ * @param arena Arena de origem.
+ * @param size Tamanho em bytes.
+ * @return Ponteiro para a memória (nunca NULL; aborta sem memória).
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Descarta todas as alocações da arena, mantendo apenas o bloco atual para
+ * ser reutilizado.
+ *
+ * Ponteiros obtidos antes da chamada deixam de ser válidos.
+ *
+ * @param arena Arena a esvaziar.
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * Libera todos os blocos da arena de uma vez.
+ *
+ * @param arena Arena a liberar.
+ */
+void arena_release(Arena *arena);
+
+#endif
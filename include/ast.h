@@ -2,14 +2,16 @@
 #define AST_H
 
 #include "types.h"
-
-#define MAX_TOKEN_LEN 256
+#include "intern.h"
+#include "arena.h"
+#include "operators.h"
 
 typedef enum {
     AST_NUMBER,
     AST_STRING,
     AST_VARIABLE,
     AST_BINARY_OP,
+    AST_UNARY_OP,
     AST_ASSIGNMENT,
     AST_IF_STATEMENT,
     AST_WHILE_STATEMENT,
@@ -18,29 +20,35 @@ typedef enum {
     AST_FUNCTION_PARAMETER,
     AST_RETURN_STATEMENT,
     AST_BLOCK,
-    AST_VARIABLE_DECLARATION
+    AST_VARIABLE_DECLARATION,
+    AST_NODE_TYPE_COUNT
 } ASTNodeType;
 
 typedef struct ASTNode ASTNode;
 
 typedef struct {
-    char value[MAX_TOKEN_LEN];
+    double value;
 } NumberNode;
 
 typedef struct {
-    char value[MAX_TOKEN_LEN];
+    Atom value;
 } StringNode;
 
 typedef struct {
-    char name[MAX_TOKEN_LEN];
+    Atom name;
 } VariableNode;
 
 typedef struct {
-    char operator[MAX_TOKEN_LEN];
+    OpKind op;
     ASTNode *left;
     ASTNode *right;
 } BinaryOpNode;
 
+typedef struct {
+    OpKind op;              // OP_NEG ou OP_NOT
+    ASTNode *operand;
+} UnaryOpNode;
+
 typedef struct {
     ASTNode *variable;
     ASTNode *expression;
@@ -58,20 +66,20 @@ typedef struct {
 } WhileStatementNode;
 
 typedef struct {
-    char function_name[MAX_TOKEN_LEN];
-    ASTNode **arguments;
+    Atom function_name;
     int arg_count;
+    ASTNode **arguments;
 } FunctionCallNode;
 
 typedef struct {
-    char name[MAX_TOKEN_LEN];
-    ASTNode **parameters;
+    Atom name;
     int param_count;
+    ASTNode **parameters;
     ASTNode *body;
 } FunctionDeclarationNode;
 
 typedef struct {
-    char name[MAX_TOKEN_LEN];
+    Atom name;
 } FunctionParameterNode;
 
 typedef struct {
@@ -79,24 +87,35 @@ typedef struct {
 } ReturnStatementNode;
 
 typedef struct {
-    ASTNode **statements;
     int statement_count;
+    ASTNode **statements;
 } BlockNode;
 
 typedef struct {
-    char name[MAX_TOKEN_LEN];
-    char type_name[MAX_TOKEN_LEN];
+    Atom name;
+    Atom type_name;        // ATOM_NONE quando não há anotação de tipo
     ASTNode *expression;
 } VariableDeclarationNode;
 
+/*
+ * Um nó é um cabeçalho fixo de 16 bytes seguido do payload do seu tipo.
+ * Cada nó é alocado apenas com o tamanho do próprio payload (ver
+ * ast_node_size), então só os campos do tipo indicado em type podem ser
+ * acessados.
+ */
 struct ASTNode {
-    ASTNodeType type;
-    DataType data_type;
+    unsigned char type;        // ASTNodeType
+    unsigned char data_type;   // DataType
+    unsigned short reserved;
+    unsigned int offset;       // Trecho do código-fonte coberto pelo nó
+    unsigned int length;
+    unsigned int line;         // Linha onde o trecho começa
     union {
         NumberNode number;
         StringNode string;
         VariableNode variable;
         BinaryOpNode binary_op;
+        UnaryOpNode unary_op;
         AssignmentNode assignment;
         IfStatementNode if_statement;
         WhileStatementNode while_statement;
@@ -109,21 +128,116 @@ struct ASTNode {
     };
 };
 
-ASTNode *create_number_node(const char *value);
-ASTNode *create_string_node(const char *value);
-ASTNode *create_variable_node(const char *name);
-ASTNode *create_binary_op_node(const char *operator, ASTNode *left, ASTNode *right);
-ASTNode *create_assignment_node(ASTNode *variable, ASTNode *expression);
-ASTNode *create_if_statement_node(ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch);
-ASTNode *create_while_statement_node(ASTNode *condition, ASTNode *body);
-ASTNode *create_function_call_node(const char *function_name, ASTNode **arguments, int arg_count);
-ASTNode *create_function_declaration_node(const char *name, ASTNode **parameters, int param_count, ASTNode *body);
-ASTNode *create_function_parameter_node(const char *name);
-ASTNode *create_return_statement_node(ASTNode *expression);
-ASTNode *create_block_node();
-ASTNode *create_variable_declaration_node(const char *name, const char *type_name, ASTNode *expression);
-
-void print_ast(ASTNode *node, int indent);
+/**
+ * Tamanho alocado para um nó do tipo indicado (cabeçalho + payload).
+ */
+size_t ast_node_size(ASTNodeType type);
+
+ASTNode *create_number_node(Arena *arena, double value);
+ASTNode *create_string_node(Arena *arena, Atom value);
+ASTNode *create_variable_node(Arena *arena, Atom name);
+ASTNode *create_binary_op_node(Arena *arena, OpKind op, ASTNode *left, ASTNode *right);
+ASTNode *create_unary_op_node(Arena *arena, OpKind op, ASTNode *operand);
+ASTNode *create_assignment_node(Arena *arena, ASTNode *variable, ASTNode *expression);
+ASTNode *create_if_statement_node(Arena *arena, ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch);
+ASTNode *create_while_statement_node(Arena *arena, ASTNode *condition, ASTNode *body);
+ASTNode *create_function_call_node(Arena *arena, Atom function_name, ASTNode **arguments, int arg_count);
+ASTNode *create_function_declaration_node(Arena *arena, Atom name, ASTNode **parameters, int param_count, ASTNode *body);
+ASTNode *create_function_parameter_node(Arena *arena, Atom name);
+ASTNode *create_return_statement_node(Arena *arena, ASTNode *expression);
+ASTNode *create_block_node(Arena *arena);
+ASTNode *create_variable_declaration_node(Arena *arena, Atom name, Atom type_name, ASTNode *expression);
+
+/*
+ * Filhos de um nó. Cada tipo de nó tem uma entrada na tabela de filhos de
+ * ast.c, então nenhuma etapa precisa saber em que campos ficam os filhos:
+ * o filho de índice i (0 <= i < ast_child_count) é obtido com ast_child.
+ * A ordem é a de avaliação: operandos da esquerda para a direita,
+ * condição antes dos ramos, parâmetros antes do corpo, variável antes da
+ * expressão de uma atribuição. Filhos opcionais ausentes (else, expressão
+ * de return ou de local) ocupam o índice e valem NULL.
+ */
+
+/**
+ * Número de filhos de node, incluindo posições opcionais vazias.
+ */
+int ast_child_count(const ASTNode *node);
+
+/**
+ * Filho de node na posição index.
+ *
+ * @param node Nó consultado.
+ * @param index Posição do filho (0 <= index < ast_child_count(node)).
+ * @return O filho ou NULL se a posição opcional estiver vazia.
+ */
+ASTNode *ast_child(const ASTNode *node, int index);
+
+/*
+ * Percurso genérico da AST com pilha explícita: a profundidade da árvore
+ * não consome a pilha nativa. Cada visitante tem um gancho pre, chamado
+ * antes dos filhos do nó, e um gancho post, chamado depois deles; qualquer
+ * um pode ser NULL.
+ *
+ * Vários visitantes podem ser combinados em um único percurso: em cada nó
+ * os ganchos pre rodam na ordem do vetor e os post na ordem inversa, então
+ * cada visitante vê os anteriores já aplicados ao entrar no nó e ainda não
+ * desfeitos ao sair dele.
+ */
+typedef enum {
+    AST_VISIT_CONTINUE,    // Visita os filhos normalmente
+    AST_VISIT_SKIP,        // Não visita os filhos (os ganchos post ainda rodam)
+    AST_VISIT_STOP         // Encerra o percurso sem chamar mais nenhum gancho
+} ASTVisitResult;
+
+// Posição do nó visitado na árvore
+typedef struct {
+    ASTNode *node;
+    ASTNode *parent;       // NULL na raiz do percurso
+    int index;             // Posição entre os filhos de parent (0 na raiz)
+    int depth;             // 0 na raiz do percurso
+} ASTVisit;
+
+typedef struct {
+    ASTVisitResult (*pre)(void *context, const ASTVisit *visit);
+    ASTVisitResult (*post)(void *context, const ASTVisit *visit);
+    void *context;
+} ASTVisitor;
+
+// Nó na pilha do percurso: next é o próximo filho a visitar
+typedef struct {
+    ASTNode *node;
+    int index;
+    int next;
+} ASTWalkFrame;
+
+/*
+ * Pilha do percurso. Etapas que percorrem muitas árvores (a análise
+ * semântica percorre um comando de cada vez) podem manter uma e
+ * reaproveitá-la entre chamadas.
+ */
+typedef struct {
+    ASTWalkFrame *frames;
+    size_t count;
+    size_t capacity;
+} ASTWalkStack;
+
+/**
+ * Percorre root em profundidade, chamando os ganchos dos visitantes.
+ *
+ * @param root Raiz do percurso (não pode ser NULL).
+ * @param visitors Visitantes a combinar no percurso.
+ * @param visitor_count Número de visitantes.
+ * @param stack Pilha a reaproveitar, ou NULL para usar uma temporária.
+ * @return 1 se o percurso terminou, 0 se algum gancho retornou AST_VISIT_STOP.
+ */
+int ast_walk(ASTNode *root, const ASTVisitor *visitors, int visitor_count, ASTWalkStack *stack);
+
+/**
+ * Libera os nós reservados por uma pilha de percurso.
+ */
+void ast_walk_stack_free(ASTWalkStack *stack);
+
+void print_ast(ASTNode *node, const AtomTable *atoms, int indent);
 void free_ast(ASTNode *node);
 
 #endif
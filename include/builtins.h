@@ -0,0 +1,25 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+/*
+ * Funções predefinidas, visíveis em todo programa como se tivessem sido
+ * declaradas antes do primeiro comando. Cada uma recebe o número indicado
+ * de argumentos de qualquer tipo e devolve nil. Na IR elas ocupam as
+ * primeiras globais, na ordem deste enum.
+ */
+typedef enum {
+    BUILTIN_PRINT,     // print(valor): escreve o valor e uma quebra de linha
+    BUILTIN_COUNT
+} Builtin;
+
+/**
+ * Nome de uma função predefinida.
+ */
+const char *builtin_name(Builtin builtin);
+
+/**
+ * Número de argumentos de uma função predefinida.
+ */
+int builtin_arity(Builtin builtin);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdio.h>
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "lower.h"
+#include "builtins.h"
+#include "diagnostics.h"
+
+/*
+ * Contexto de uma compilação.
+ *
+ * Reúne todo o estado do front end (lexer, parser, tabela de átomos, arena
+ * da AST e inferência de tipos) e, se lowering estiver ligado antes de a
+ * entrada ser aberta, a tradução de cada comando para a IR em program. Contextos distintos não compartilham nada,
+ * então podem ser usados em threads diferentes ao mesmo tempo. Nenhuma
+ * função encerra o processo por causa da entrada: erros são devolvidos como
+ * COMPILER_ERROR e descritos em diagnostics.
+ */
+typedef enum {
+    COMPILER_OK,      // Operação concluída (ou um comando foi produzido)
+    COMPILER_DONE,    // Fim da entrada
+    COMPILER_ERROR    // Erro; detalhes em context->diagnostics
+} CompilerStatus;
+
+typedef struct {
+    AtomTable atoms;
+    Arena ast_arena;
+    LexerState lexer;
+    ParserState parser;
+    SemanticState semantic;
+    LowerState lower;
+    IRProgram program;
+    Diagnostics diagnostics;
+    int debug_mode;
+    int lowering;   // Traduz os comandos verificados para program
+    int opened;     // Uma entrada foi aberta (lexer e parser inicializados)
+    int failed;     // Um erro fatal interrompeu a compilação
+} CompilerContext;
+
+/**
+ * Inicializa um contexto vazio.
+ *
+ * @param context Contexto a inicializar.
+ */
+void compiler_init(CompilerContext *context);
+
+/**
+ * Libera toda a memória do contexto, inclusive a entrada aberta.
+ *
+ * @param context Contexto a liberar.
+ */
+void compiler_free(CompilerContext *context);
+
+/**
+ * Abre o arquivo indicado como entrada ("-" lê a entrada padrão).
+ *
+ * @param context Contexto sem entrada aberta.
+ * @param path Caminho do arquivo.
+ * @return COMPILER_OK ou COMPILER_ERROR.
+ */
+CompilerStatus compiler_open_path(CompilerContext *context, const char *path);
+
+/**
+ * Usa um buffer em memória como entrada. O buffer não é copiado e deve
+ * permanecer válido até compiler_free.
+ *
+ * @param context Contexto sem entrada aberta.
+ * @param source Código-fonte.
+ * @param length Tamanho do código-fonte em bytes.
+ * @return COMPILER_OK.
+ */
+CompilerStatus compiler_open_buffer(CompilerContext *context, const char *source, size_t length);
+
+/**
+ * Parsea e verifica o próximo comando de nível superior (e o traduz para a
+ * IR, com lowering ligado; no fim da entrada o programa é encerrado).
+ *
+ * O comando devolvido permanece válido até a próxima chamada, que reutiliza
+ * a memória da AST.
+ *
+ * @param context Contexto com uma entrada aberta.
+ * @param statement Recebe o comando verificado (NULL no fim ou em erro).
+ * @return COMPILER_OK, COMPILER_DONE ou COMPILER_ERROR.
+ */
+CompilerStatus compiler_next_statement(CompilerContext *context, ASTNode **statement);
+
+/**
+ * Parsea e verifica a entrada inteira.
+ *
+ * @param context Contexto com uma entrada aberta.
+ * @param program Recebe o bloco com todos os comandos (válido até compiler_free).
+ * @return COMPILER_OK ou COMPILER_ERROR.
+ */
+CompilerStatus compiler_check(CompilerContext *context, ASTNode **program);
+
+#endif
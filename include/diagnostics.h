@@ -0,0 +1,89 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/*
+ * Mensagens de erro produzidas durante uma compilação.
+ *
+ * Nenhuma etapa do compilador encerra o processo: erros são acumulados em
+ * uma lista de diagnósticos. Erros fatais (dos quais o parser ou o
+ * verificador de tipos não conseguem continuar) desviam a execução, com
+ * longjmp, para o ponto de recuperação registrado em recover pela função
+ * da API que iniciou a etapa.
+ */
+typedef struct {
+    int line;
+    int column;
+    char *message;
+} Diagnostic;
+
+typedef struct {
+    Diagnostic *items;
+    size_t count;
+    size_t capacity;
+    jmp_buf *recover;   // Destino de diagnostics_fatal
+} Diagnostics;
+
+/**
+ * Inicializa uma lista de diagnósticos vazia.
+ *
+ * @param diagnostics Lista a inicializar.
+ */
+void diagnostics_init(Diagnostics *diagnostics);
+
+/**
+ * Libera as mensagens e a lista de diagnósticos.
+ *
+ * @param diagnostics Lista a liberar.
+ */
+void diagnostics_free(Diagnostics *diagnostics);
+
+/**
+ * Registra um diagnóstico formatado como printf.
+ *
+ * @param diagnostics Lista de destino.
+ * @param line Linha do erro (0 se desconhecida).
+ * @param column Coluna do erro (0 se desconhecida).
+ * @param format Formato da mensagem.
+ */
+void diagnostics_report(Diagnostics *diagnostics, int line, int column, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+/**
+ * Versão de diagnostics_report que recebe os argumentos em um va_list.
+ */
+void diagnostics_vreport(Diagnostics *diagnostics, int line, int column, const char *format, va_list args);
+
+/**
+ * Registra um diagnóstico e abandona a etapa atual, retornando ao ponto de
+ * recuperação em recover. Chamar sem ponto de recuperação é um erro de uso
+ * da API e aborta o processo.
+ *
+ * @param diagnostics Lista de destino.
+ * @param line Linha do erro (0 se desconhecida).
+ * @param column Coluna do erro (0 se desconhecida).
+ * @param format Formato da mensagem.
+ */
+void diagnostics_fatal(Diagnostics *diagnostics, int line, int column, const char *format, ...)
+    __attribute__((format(printf, 4, 5), noreturn));
+
+/**
+ * Abandona a etapa atual sem registrar nada (o erro já foi registrado).
+ *
+ * @param diagnostics Lista com o ponto de recuperação.
+ */
+void diagnostics_abort(Diagnostics *diagnostics) __attribute__((noreturn));
+
+/**
+ * Escreve todos os diagnósticos, um por linha.
+ *
+ * @param diagnostics Lista a imprimir.
+ * @param out Destino (normalmente stderr).
+ */
+void diagnostics_print(const Diagnostics *diagnostics, FILE *out);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+/*
+ * Tabela de internação de nomes.
+ *
+ * Cada nome distinto recebe um identificador denso (Atom), de modo que
+ * comparar nomes passa a ser comparar inteiros. O átomo 0 (ATOM_NONE) é
+ * reservado para "sem nome".
+ */
+typedef unsigned int Atom;
+
+#define ATOM_NONE 0u
+
+typedef struct {
+    char *chars;             // Textos de todos os átomos, terminados em '\0'
+    size_t chars_length;
+    size_t chars_capacity;
+    unsigned int *offsets;   // Átomo -> posição do texto em chars
+    unsigned int *lengths;   // Átomo -> tamanho do texto
+    unsigned int *hashes;    // Átomo -> hash do texto
+    unsigned int count;      // Número de átomos (incluindo ATOM_NONE)
+    unsigned int capacity;
+    Atom *slots;             // Tabela hash com endereçamento aberto (0 = vazio)
+    unsigned int slot_mask;
+} AtomTable;
+
+/**
+ * Inicializa uma tabela de átomos vazia.
+ *
+ * @param table Tabela a inicializar.
+ */
+void atom_table_init(AtomTable *table);
+
+/**
+ * Libera a memória da tabela de átomos.
+ *
+ * @param table Tabela a liberar.
+ */
+void atom_table_free(AtomTable *table);
+
+/**
+ * Retorna o átomo do texto, criando-o na primeira ocorrência.
+ *
+ * @param table Tabela de átomos.
+ * @param text Início do texto (não precisa terminar em '\0').
+ * @param length Tamanho do texto em bytes.
+ * @return Átomo correspondente.
+ */
+Atom atom_intern(AtomTable *table, const char *text, size_t length);
+
+/**
+ * Texto de um átomo, terminado em '\0'.
+ *
+ * O ponteiro deixa de ser válido quando novos átomos são criados.
+ *
+ * @param table Tabela de átomos.
+ * @param atom Átomo consultado.
+ * @return Texto do átomo ("" para ATOM_NONE).
+ */
+const char *atom_name(const AtomTable *table, Atom atom);
+
+/**
+ * Tamanho do texto de um átomo.
+ *
+ * @param table Tabela de átomos.
+ * @param atom Átomo consultado.
+ * @return Tamanho em bytes.
+ */
+size_t atom_length(const AtomTable *table, Atom atom);
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "intern.h"
+
+/*
+ * Representação intermediária: bytecode baseado em registradores.
+ *
+ * Cada instrução ocupa 32 bits, com o código da operação nos 8 bits
+ * menores e os operandos em um dos formatos abaixo:
+ *
+ *   ABC  op:8 A:8 B:8 C:8     registradores (e pequenos inteiros)
+ *   ABx  op:8 A:8 Bx:16       registrador e índice (constante ou global)
+ *   sJ   op:8 sJ:24           deslocamento de salto com sinal
+ *   Ax   op:8 Ax:24           argumento estendido
+ *
+ * Um índice Bx que não cabe em 16 bits é codificado como IR_BX_EXTENDED e
+ * o valor real segue na próxima instrução, uma IR_EXTRAARG com Ax.
+ *
+ * Os saltos são relativos à instrução seguinte: um IR_JMP na posição pc
+ * continua em pc + 1 + sJ. Desvios condicionais são um IR_TEST seguido de
+ * um IR_JMP, que só é executado quando o teste passa.
+ *
+ * Uma função aninhada lê e escreve variáveis locais das funções envolventes
+ * por upvalues (U[i], descritos em IRFunction.upvalues): IR_CLOSURE cria o
+ * valor da função capturando essas variáveis, que continuam compartilhadas
+ * com a função envolvente até saírem de escopo (IR_CLOSE ou o retorno dela).
+ */
+typedef uint32_t IRInstruction;
+
+typedef enum {
+    IR_MOVE,        // A B      R[A] = R[B]
+    IR_LOADK,       // A Bx     R[A] = K[Bx]
+    IR_LOADNIL,     // A        R[A] = nil
+    IR_GETGLOBAL,   // A Bx     R[A] = G[Bx]
+    IR_SETGLOBAL,   // A Bx     G[Bx] = R[A]
+    IR_GETUPVAL,    // A B      R[A] = U[B]
+    IR_SETUPVAL,    // A B      U[B] = R[A]
+    IR_CLOSURE,     // A Bx     R[A] = função Bx com os upvalues capturados agora
+    IR_ADD,         // A B C    R[A] = R[B] + R[C] (números)
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_POW,
+    IR_CONCAT,      // A B C    R[A] = R[B] .. R[C] (strings)
+    IR_EQ,          // A B C    R[A] = R[B] == R[C]
+    IR_NE,
+    IR_LT,          // A B C    R[A] = R[B] < R[C] (números ou strings)
+    IR_LE,
+    IR_LTN,         // A B C    IR_LT com os dois operandos números
+    IR_LEN,
+    IR_NOT,         // A B      R[A] = not R[B]
+    IR_NEG,         // A B      R[A] = -R[B]
+    IR_TEST,        // A C      executa o próximo salto só se R[A] tiver verdade C
+    IR_JMP,         // sJ       pc += sJ
+    IR_CALL,        // A B      R[A] = R[A](R[A+1], ..., R[A+B])
+    IR_RETURN,      // A B      retorna R[A] (B = 1) ou nil (B = 0)
+    IR_CLOSE,       // A        as variáveis de R[A] em diante saem de escopo
+    IR_EXTRAARG,    // Ax       índice estendido da instrução anterior
+    IR_OPCODE_COUNT
+} IROpcode;
+
+#define IR_MAX_REGISTERS 250
+#define IR_MAX_UPVALUES 255
+#define IR_BX_EXTENDED 0xFFFFu
+#define IR_AX_MAX 0xFFFFFFu
+#define IR_SJ_MAX ((1 << 23) - 1)
+#define IR_SJ_MIN (-(1 << 23))
+
+#define IR_OP(i) ((IROpcode)((i) & 0xFFu))
+#define IR_A(i) ((int)(((i) >> 8) & 0xFFu))
+#define IR_B(i) ((int)(((i) >> 16) & 0xFFu))
+#define IR_C(i) ((int)((i) >> 24))
+#define IR_BX(i) ((unsigned int)((i) >> 16))
+#define IR_AX(i) ((unsigned int)((i) >> 8))
+#define IR_SJ(i) ((int)((i) >> 8) - (1 << 23))
+
+#define IR_MAKE_ABC(op, a, b, c) \
+    ((IRInstruction)(op) | ((IRInstruction)(a) << 8) | ((IRInstruction)(b) << 16) | ((IRInstruction)(c) << 24))
+#define IR_MAKE_ABX(op, a, bx) ((IRInstruction)(op) | ((IRInstruction)(a) << 8) | ((IRInstruction)(bx) << 16))
+#define IR_MAKE_AX(op, ax) ((IRInstruction)(op) | ((IRInstruction)(ax) << 8))
+#define IR_MAKE_SJ(op, sj) IR_MAKE_AX(op, (IRInstruction)((sj) + (1 << 23)))
+
+typedef enum {
+    IR_CONST_NUMBER,
+    IR_CONST_STRING,
+    IR_CONST_FUNCTION
+} IRConstantKind;
+
+typedef struct {
+    IRConstantKind kind;
+    union {
+        double number;
+        Atom string;           // Texto na tabela de átomos da compilação
+        unsigned int function; // Índice em IRProgram.functions
+    };
+} IRConstant;
+
+/*
+ * Variável de uma função envolvente usada por uma função aninhada. Com
+ * in_stack, index é o registrador da variável na função imediatamente
+ * envolvente; sem, é o índice de um upvalue dela.
+ */
+typedef struct {
+    Atom name;
+    unsigned char in_stack;
+    unsigned char index;
+} IRUpvalue;
+
+/*
+ * Uma função compilada. Os parâmetros ocupam os primeiros registradores;
+ * register_count é o tamanho do quadro da função na pilha de valores.
+ * Constantes iguais são compartilhadas dentro da função.
+ */
+typedef struct {
+    Atom name;                 // ATOM_NONE no código de nível superior
+    int param_count;
+    int register_count;
+    unsigned int line;
+    IRInstruction *code;
+    unsigned int *lines;       // Linha de origem de cada instrução
+    size_t code_count;
+    size_t code_capacity;
+    IRConstant *constants;
+    unsigned int constant_count;
+    unsigned int constant_capacity;
+    unsigned int *constant_slots; // Índice + 1 de cada constante (0 = vazio)
+    unsigned int constant_mask;
+    IRUpvalue *upvalues;
+    unsigned int upvalue_count;
+    unsigned int upvalue_capacity;
+} IRFunction;
+
+/*
+ * Programa inteiro: functions[0] é o código de nível superior, executado
+ * uma vez, e as variáveis declaradas nele são as globais.
+ */
+typedef struct {
+    IRFunction *functions;
+    size_t function_count;
+    size_t function_capacity;
+    unsigned int global_count;
+} IRProgram;
+
+/**
+ * Inicializa um programa só com a função de nível superior, vazia.
+ *
+ * @param program Programa a inicializar.
+ */
+void ir_program_init(IRProgram *program);
+
+/**
+ * Libera as funções do programa.
+ *
+ * @param program Programa a liberar.
+ */
+void ir_program_free(IRProgram *program);
+
+/**
+ * Acrescenta uma função vazia ao programa.
+ *
+ * @param program Programa de destino.
+ * @param name Nome da função.
+ * @param param_count Número de parâmetros.
+ * @param line Linha da declaração.
+ * @return Índice da nova função.
+ */
+unsigned int ir_add_function(IRProgram *program, Atom name, int param_count, unsigned int line);
+
+/**
+ * Acrescenta uma instrução à função.
+ *
+ * @param function Função de destino.
+ * @param instruction Instrução codificada.
+ * @param line Linha de origem.
+ * @return Posição da instrução.
+ */
+size_t ir_emit(IRFunction *function, IRInstruction instruction, unsigned int line);
+
+/**
+ * Acrescenta uma instrução no formato ABx, estendendo Bx com IR_EXTRAARG
+ * quando ele não cabe em 16 bits.
+ */
+void ir_emit_abx(IRFunction *function, IROpcode op, int a, unsigned int bx, unsigned int line);
+
+/**
+ * Índice de uma constante no pool da função, acrescentando-a se for nova.
+ *
+ * @param function Função dona do pool.
+ * @param constant Constante procurada.
+ * @return Índice da constante.
+ */
+unsigned int ir_constant(IRFunction *function, IRConstant constant);
+
+/**
+ * Índice de um upvalue da função, acrescentando-o se for novo.
+ *
+ * @param function Função que usa a variável.
+ * @param upvalue Origem da variável na função envolvente.
+ * @return Índice do upvalue.
+ */
+unsigned int ir_upvalue(IRFunction *function, IRUpvalue upvalue);
+
+/**
+ * Nome de uma operação (para a listagem).
+ */
+const char *ir_opcode_name(IROpcode op);
+
+/**
+ * Escreve a listagem de todas as funções do programa.
+ *
+ * @param program Programa a listar.
+ * @param atoms Tabela de átomos da compilação.
+ * @param out Destino.
+ */
+void ir_print(const IRProgram *program, const AtomTable *atoms, FILE *out);
+
+#endif
@@ -2,8 +2,11 @@
 #define LEXER_H
 
 #include <stdio.h>
-
-#define MAX_TOKEN_LEN 256
+#include <stddef.h>
+#include "lexer_simd.h"
+#include "intern.h"
+#include "operators.h"
+#include "diagnostics.h"
 
 typedef enum {
     TOKEN_EOF,
@@ -22,63 +25,238 @@ typedef enum {
     TOKEN_UNKNOWN
 } TokenType;
 
+/*
+ * Palavras-chave reconhecidas pelo lexer. Tokens TOKEN_KEYWORD carregam o
+ * valor correspondente, então nenhuma etapa posterior compara o texto.
+ */
+typedef enum {
+    KW_AND,
+    KW_DO,
+    KW_ELSE,
+    KW_ELSEIF,
+    KW_END,
+    KW_FOR,
+    KW_FUNCTION,
+    KW_IF,
+    KW_LOCAL,
+    KW_NIL,
+    KW_NOT,
+    KW_OR,
+    KW_RETURN,
+    KW_THEN,
+    KW_WHILE,
+    KW_COUNT,
+    KW_NONE = KW_COUNT
+} Keyword;
+
+typedef union {
+    double number;         // TOKEN_NUMBER: valor já convertido
+    Keyword keyword;       // TOKEN_KEYWORD
+    OpKind op;             // TOKEN_OPERATOR
+    Atom atom;             // TOKEN_IDENTIFIER e TOKEN_STRING: texto internado
+} TokenValue;
+
+/*
+ * Um token não copia o texto: ele aponta para o lexema no buffer de origem
+ * por meio de (offset, length). O texto deve ser obtido com token_text.
+ */
 typedef struct {
     TokenType type;
-    char value[MAX_TOKEN_LEN];
+    unsigned int offset;   // Posição do lexema no buffer de origem
+    unsigned int length;   // Tamanho do lexema em bytes
     int line;
     int column;
+    TokenValue value;
 } Token;
 
+/*
+ * O lexer sempre trabalha sobre um buffer contíguo [source, end). O buffer
+ * pode ser um arquivo mapeado com mmap, o conteúdo lido de um FILE* (que
+ * passa a pertencer ao lexer) ou uma string em memória fornecida pelo
+ * chamador.
+ */
 typedef struct {
-    FILE *file;
-    int current_char;
+    const char *source;   // Início do buffer de entrada
+    const char *cursor;   // Próximo byte a ser lido
+    const char *end;      // Um byte após o fim do buffer
+    const char *line_start; // Início da linha atual (a coluna é derivada dele)
     int line;
-    int column;
-    int debug_mode; 
+    int debug_mode;
+    ScanFunction scan;    // Varreduras rápidas (SIMD ou escalar) escolhidas na inicialização
+    AtomTable *atoms;     // Tabela onde identificadores e strings são internados (opcional)
+    Diagnostics *diagnostics; // Onde erros léxicos são registrados (opcional)
+    char *owned_buffer;   // Buffer alocado pelo lexer (liberado em lexer_free)
+    size_t mapped_size;   // Tamanho do mapeamento quando a fonte veio de mmap
 } LexerState;
 
+/*
+ * Sequência de tokens de um arquivo inteiro em formato struct-of-arrays.
+ * O token de índice i é formado por kinds[head + i], offsets[head + i],
+ * lengths[head + i], etc.; o último token é sempre TOKEN_EOF. Os tokens
+ * antes de head já foram descartados e o seu espaço é reaproveitado quando
+ * os vetores enchem.
+ */
+typedef struct {
+    unsigned char *kinds;
+    unsigned int *offsets;
+    unsigned int *lengths;
+    int *lines;
+    int *columns;
+    TokenValue *values;
+    size_t head;          // Posição do token de índice 0 nos vetores
+    size_t count;         // Tokens mantidos (a partir de head)
+    size_t capacity;
+} TokenStream;
+
 /**
  * Inicializa o lexer com o arquivo fornecido.
  *
+ * O conteúdo do arquivo é lido por completo para um buffer interno, então
+ * fluxos não posicionáveis (pipes, stdin) também são aceitos.
+ *
  * @param lexer Ponteiro para o estado do lexer.
  * @param file Arquivo a ser analisado.
  */
 void lexer_init(LexerState *lexer, FILE *file);
 
 /**
- * Obtém o próximo token do arquivo.
+ * Inicializa o lexer sobre um buffer em memória.
+ *
+ * O buffer não é copiado e deve permanecer válido enquanto o lexer (e os
+ * tokens produzidos por ele) estiverem em uso.
  *
  * @param lexer Ponteiro para o estado do lexer.
- * @return Token obtido.
+ * @param source Início do código-fonte.
+ * @param length Tamanho do código-fonte em bytes.
  */
-Token lexer_get_next_token(LexerState *lexer);
+void lexer_init_buffer(LexerState *lexer, const char *source, size_t length);
 
 /**
- * Imprime informações sobre o token (para depuração).
+ * Inicializa o lexer mapeando o arquivo indicado em memória (mmap).
  *
- * @param token Token a ser impresso.
+ * Quando o mapeamento não é possível (arquivo vazio, pipe, etc.), o arquivo
+ * é lido para um buffer interno como em lexer_init.
+ *
+ * @param lexer Ponteiro para o estado do lexer.
+ * @param path Caminho do arquivo.
+ * @return 0 em caso de sucesso, -1 em caso de erro (errno é preenchido).
  */
-void token_print(Token token);/**
- * Inicializa o lexer com o arquivo fornecido.
+int lexer_init_path(LexerState *lexer, const char *path);
+
+/**
+ * Libera o buffer ou o mapeamento pertencente ao lexer.
  *
  * @param lexer Ponteiro para o estado do lexer.
- * @param file Arquivo a ser analisado.
  */
-void lexer_init(LexerState *lexer, FILE *file);
+void lexer_free(LexerState *lexer);
 
 /**
  * Obtém o próximo token do arquivo.
  *
+ * Um erro léxico é registrado em lexer->diagnostics (se houver) e produz
+ * um token TOKEN_UNKNOWN; a leitura continua após o trecho inválido.
+ *
  * @param lexer Ponteiro para o estado do lexer.
  * @return Token obtido.
  */
 Token lexer_get_next_token(LexerState *lexer);
 
+/**
+ * Converte todo o restante da entrada em uma sequência de tokens.
+ *
+ * @param lexer Ponteiro para o estado do lexer.
+ * @param stream Sequência a ser preenchida (deve estar zerada).
+ */
+void lexer_tokenize(LexerState *lexer, TokenStream *stream);
+
+/**
+ * Acrescenta à sequência no máximo max tokens da entrada.
+ *
+ * Para depois de acrescentar o TOKEN_EOF; chamadas seguintes não
+ * acrescentam nada.
+ *
+ * @param lexer Ponteiro para o estado do lexer.
+ * @param stream Sequência a ser estendida.
+ * @param max Número máximo de tokens a acrescentar.
+ * @return Número de tokens acrescentados.
+ */
+size_t lexer_tokenize_some(LexerState *lexer, TokenStream *stream, size_t max);
+
+/**
+ * Monta o token de índice index a partir da sequência.
+ *
+ * Índices além do fim retornam o token TOKEN_EOF final.
+ *
+ * @param stream Sequência de tokens.
+ * @param index Índice do token.
+ * @return Token correspondente.
+ */
+Token token_stream_get(const TokenStream *stream, size_t index);
+
+/**
+ * Libera os vetores da sequência de tokens.
+ *
+ * @param stream Sequência de tokens.
+ */
+void token_stream_free(TokenStream *stream);
+
+/**
+ * Descarta os n primeiros tokens da sequência, mantendo os demais.
+ *
+ * Usado pelo parser em modo de fluxo para liberar os tokens de comandos já
+ * concluídos; os índices dos tokens restantes diminuem em n. Só avança o
+ * início da sequência: os tokens mantidos são movidos uma vez, quando os
+ * vetores enchem, e não a cada descarte.
+ *
+ * @param stream Sequência de tokens.
+ * @param n Número de tokens a descartar.
+ */
+void token_stream_discard(TokenStream *stream, size_t n);
+
+/**
+ * Identifica uma palavra-chave por hash perfeito.
+ *
+ * @param text Início do identificador (não precisa terminar em '\0').
+ * @param length Tamanho do identificador.
+ * @return A palavra-chave correspondente ou KW_NONE.
+ */
+Keyword keyword_lookup(const char *text, size_t length);
+
+/**
+ * Texto de uma palavra-chave (para mensagens).
+ *
+ * @param keyword Palavra-chave.
+ * @return Texto da palavra-chave.
+ */
+const char *keyword_name(Keyword keyword);
+
+/**
+ * Retorna o início do lexema do token no buffer de origem.
+ *
+ * O texto não termina em '\0'; use token.length como tamanho.
+ *
+ * @param lexer Lexer que produziu o token.
+ * @param token Token consultado.
+ * @return Ponteiro para o primeiro byte do lexema.
+ */
+const char *token_text(const LexerState *lexer, Token token);
+
+/**
+ * Compara o lexema do token com uma string terminada em '\0'.
+ *
+ * @param lexer Lexer que produziu o token.
+ * @param token Token consultado.
+ * @param text Texto a comparar.
+ * @return 1 se forem iguais, 0 caso contrário.
+ */
+int token_equals(const LexerState *lexer, Token token, const char *text);
+
 /**
  * Imprime informações sobre o token (para depuração).
  *
+ * @param lexer Lexer que produziu o token.
  * @param token Token a ser impresso.
  */
-void token_print(Token token);
+void token_print(const LexerState *lexer, Token token);
 
 #endif
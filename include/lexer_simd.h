@@ -0,0 +1,40 @@
+#ifndef LEXER_SIMD_H
+#define LEXER_SIMD_H
+
+/*
+ * Varreduras rápidas usadas pelo lexer em trechos longos da entrada.
+ *
+ * Cada varredura avança enquanto o estado do autômato não mudaria e para
+ * no primeiro byte que o encerra (ou em end). As quebras de linha
+ * atravessadas são contadas para manter linha e coluna exatas.
+ */
+typedef enum {
+    SCAN_NONE,
+    SCAN_SPACE,          // Espaços em branco, inclusive '\n'
+    SCAN_IDENT,          // Letras, dígitos e '_'
+    SCAN_STRING,         // Corpo de string: para no '"'
+    SCAN_LINE,           // Comentário de linha: para no '\n'
+    SCAN_LONG_COMMENT    // Comentário longo: para no ']'
+} ScanKind;
+
+typedef const char *(*ScanFunction)(const char *p, const char *end, ScanKind kind,
+                                    int *line, const char **line_start);
+
+/**
+ * Escolhe a implementação das varreduras para a CPU atual (AVX2, SSE2 ou
+ * escalar). A variável de ambiente LUNATICO_SIMD ("scalar", "sse2" ou
+ * "avx2") força uma implementação, quando suportada.
+ *
+ * @return Função de varredura selecionada.
+ */
+ScanFunction lexer_select_scanner(void);
+
+/**
+ * Nome da implementação de varredura (para diagnóstico).
+ *
+ * @param scan Função retornada por lexer_select_scanner.
+ * @return "avx2", "sse2" ou "scalar".
+ */
+const char *lexer_scanner_name(ScanFunction scan);
+
+#endif
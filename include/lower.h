@@ -0,0 +1,125 @@
+#ifndef LOWER_H
+#define LOWER_H
+
+#include "ast.h"
+#include "ir.h"
+#include "arena.h"
+#include "symbol_table.h"
+#include "diagnostics.h"
+
+/*
+ * Tradução da AST já verificada para a IR (ver ir.h).
+ *
+ * Variáveis declaradas no nível superior viram globais; as declaradas
+ * dentro de funções (e os parâmetros) ocupam registradores do quadro da
+ * função. Uma função declarada dentro de outra também é uma variável local
+ * da envolvente. Variáveis locais de funções envolventes são acessadas por
+ * upvalues; o bloco que declara uma variável capturada termina com
+ * IR_CLOSE, para que cada execução do bloco tenha uma variável nova.
+ */
+typedef enum {
+    LOWER_GLOBAL,     // index é a global
+    LOWER_LOCAL,      // index é o registrador na função depth
+    LOWER_FUNCTION    // index é a função (o nome dentro do próprio corpo)
+} LowerBindingKind;
+
+typedef struct {
+    LowerBindingKind kind;
+    int depth;
+    unsigned int index;
+    int captured;            // Usada por uma função aninhada (locais)
+} LowerBinding;
+
+// Entrada do registro de desfazer do ambiente (como EnvEntry em semantic.h)
+typedef struct {
+    Atom name;
+    LowerBinding *binding;
+    LowerBinding *shadowed;
+} LowerEntry;
+
+/*
+ * Função em tradução. Os registradores [0, locals) guardam variáveis
+ * locais; [locals, free_reg) são temporários ocupados por subexpressões.
+ */
+typedef struct {
+    unsigned int function;   // Índice em program->functions
+    int locals;
+    int free_reg;
+} LowerFunction;
+
+// Estado de um nó em tradução (empilhado em paralelo ao percurso da AST)
+typedef struct {
+    size_t scope;            // Marca do ambiente (blocos e funções)
+    int locals;              // Locais ativos ao entrar no bloco
+    int reg;                 // Registrador da função chamada (chamadas) ou declarada (funções aninhadas)
+    unsigned int function;   // Função declarada (declarações)
+    size_t jump;             // Salto a corrigir (if, while, and, or)
+    size_t loop;             // Início do laço (while)
+} LowerFrame;
+
+typedef struct {
+    IRProgram *program;
+    SymbolTable bindings;    // Átomo -> ligação visível (LowerBinding *)
+    LowerEntry *undo;
+    size_t undo_count;
+    size_t undo_capacity;
+    Arena arena;             // Ligações
+    LowerFunction *functions; // Funções em tradução; a primeira é o nível superior
+    size_t function_count;
+    size_t function_capacity;
+    LowerFrame *frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    int *values;             // Registradores com os valores das subexpressões
+    size_t value_count;
+    size_t value_capacity;
+    ASTWalkStack walk;
+    unsigned int line;       // Linha do nó em tradução
+    int finished;
+    const AtomTable *atoms;
+    Diagnostics *diagnostics;
+} LowerState;
+
+/**
+ * Prepara a tradução para um programa recém-inicializado.
+ *
+ * @param lower Estado da tradução.
+ * @param program Programa de destino (ver ir_program_init).
+ * @param atoms Tabela de átomos da compilação (para mensagens).
+ * @param diagnostics Destino dos erros.
+ */
+void lower_begin(LowerState *lower, IRProgram *program, const AtomTable *atoms, Diagnostics *diagnostics);
+
+/**
+ * Declara uma função predefinida na próxima global livre. As predefinidas
+ * devem ser declaradas antes do primeiro comando, na ordem de builtins.h.
+ *
+ * @param lower Estado da tradução.
+ * @param name Nome da função.
+ */
+void lower_declare_builtin(LowerState *lower, Atom name);
+
+/**
+ * Traduz um comando de nível superior já verificado, acrescentando-o ao
+ * código de nível superior. Erros desviam para diagnostics->recover.
+ *
+ * @param lower Estado da tradução.
+ * @param statement Comando a traduzir.
+ */
+void lower_statement(LowerState *lower, ASTNode *statement);
+
+/**
+ * Encerra o código de nível superior. Chamadas seguintes não fazem nada.
+ *
+ * @param lower Estado da tradução.
+ */
+void lower_finish(LowerState *lower);
+
+/**
+ * Libera o estado da tradução (o programa pertence ao chamador).
+ *
+ * @param lower Estado da tradução.
+ */
+void lower_free(LowerState *lower);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+/*
+ * Operadores reconhecidos pelo lexer. Tokens TOKEN_OPERATOR carregam o
+ * valor correspondente, e o parser e o verificador de tipos despacham por
+ * tabelas indexadas por ele. OP_NONE (zero) marca um operador inválido.
+ * and, or e not chegam como palavras-chave e são convertidos pelo parser.
+ */
+typedef enum {
+    OP_NONE,
+    OP_ADD,     // +
+    OP_SUB,     // -
+    OP_MUL,     // *
+    OP_DIV,     // /
+    OP_MOD,     // %
+    OP_EQ,      // ==
+    OP_NE,      // ~=
+    OP_LT,      // <
+    OP_LE,      // <=
+    OP_GT,      // >
+    OP_GE,      // >=
+    OP_POW,     // ^
+    OP_CONCAT,  // ..
+    OP_AND,     // and (palavra-chave)
+    OP_OR,      // or (palavra-chave)
+    OP_NOT,     // not (palavra-chave, unário)
+    OP_NEG,     // - unário (o lexer sempre produz OP_SUB)
+    OP_ASSIGN,  // =
+    OP_COUNT
+} OpKind;
+
+/**
+ * Texto de um operador (para mensagens e impressão da AST).
+ *
+ * @param op Operador.
+ * @return Texto do operador.
+ */
+const char *op_name(OpKind op);
+
+#endif
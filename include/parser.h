@@ -5,15 +5,61 @@
 #include "lexer.h"
 #include "ast.h"
 
+/*
+ * Operador ainda sem operando direito completo em parse_subexpression. As
+ * expressões são lidas com esta pilha explícita, então cadeias longas de
+ * operadores não consomem a pilha nativa.
+ */
+typedef struct {
+    ASTNode *left;         // Operando esquerdo (NULL para operadores unários)
+    Token start;           // Primeiro token da expressão fechada pelo operador
+    OpKind op;
+    int limit;             // Limite a restaurar quando o operador for reduzido
+} ParserOperator;
+
+/*
+ * Construções aninhadas (blocos e subexpressões) aceitas antes de um erro.
+ * É um limite da linguagem: cada nível custa algumas centenas de bytes de
+ * pilha nativa, e 10000 níveis cabem com folga numa pilha de 8 MB mesmo sem
+ * otimização. Compile com -DPARSER_MAX_DEPTH=N para mudá-lo.
+ */
+#ifndef PARSER_MAX_DEPTH
+#define PARSER_MAX_DEPTH 10000
+#endif
+
 typedef struct {
     LexerState *lexer;
+    Arena *arena;          // Onde os nós da AST são alocados
+    TokenStream tokens;    // Janela de tokens lidos e ainda não descartados
+    size_t position;       // Índice de current_token em tokens
     Token current_token;
+    ASTNode **scratch;     // Pilha de filhos de listas ainda abertas (blocos, argumentos, parâmetros)
+    size_t scratch_count;
+    size_t scratch_capacity;
+    ParserOperator *operators; // Pilha de operadores pendentes das expressões abertas
+    size_t operator_count;
+    size_t operator_capacity;
+    int depth;             // Blocos e subexpressões abertos (limitado a PARSER_MAX_DEPTH)
     int debug_mode;
 } ParserState;
 
-void parser_init(ParserState *parser, LexerState *lexer);
+void parser_init(ParserState *parser, LexerState *lexer, Arena *arena);
+void parser_free(ParserState *parser);
 ASTNode *parse(ParserState *parser);
+
+/**
+ * Parsea o próximo comando de nível superior.
+ *
+ * Os tokens dos comandos já devolvidos são descartados, então o parser só
+ * mantém em memória os tokens do comando atual. O chamador pode liberar os
+ * nós de um comando (por exemplo com arena_reset) antes de pedir o próximo.
+ *
+ * @param parser Estado do parser.
+ * @return O comando lido, ou NULL no fim da entrada.
+ */
+ASTNode *parse_next_toplevel(ParserState *parser);
 void parser_eat(ParserState *parser, TokenType type);
+Token parser_peek(ParserState *parser, size_t k);
 Token parser_peek_next_token(ParserState *parser);
 
 #endif
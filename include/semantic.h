@@ -2,31 +2,163 @@
 #define SEMANTIC_H
 
 #include "ast.h"
+#include "diagnostics.h"
+#include "symbol_table.h"
 #include <stdlib.h>
 
 
 typedef enum { TVAR, TPRIM, TFUN } TypeKind;
 
+/*
+ * Variáveis de tipo formam uma estrutura union-find: variáveis unificadas
+ * entre si ficam na mesma classe, representada pela raiz (parent == NULL).
+ * Só a raiz pode ser ligada a um tipo concreto (instance), que nunca é
+ * outra variável.
+ *
+ * Tipos primitivos são instâncias únicas e tipos de função são
+ * compartilhados (hash-consing), então tipos com o mesmo ponteiro são
+ * iguais e nenhum dos dois é modificado depois de criado.
+ */
 typedef struct Type {
     TypeKind kind;
     int var_id;            // TVAR
+    int rank;              // TVAR: limite da altura da árvore (união por posto)
+    int level;             // TVAR: nível de let onde a variável foi criada (ou TYPE_LEVEL_GENERIC)
     DataType prim;         // TPRIM
     struct Type *arg, *ret; // TFUN
-    struct Type *instance; 
+    struct Type *parent;   // TVAR: pai na union-find (NULL na raiz)
+    struct Type *instance; // TVAR raiz: tipo ao qual a classe foi ligada
+    struct Type *copy;     // TVAR genérica: cópia durante uma instanciação
 } Type;
 
+// Nível das variáveis quantificadas de um esquema
+#define TYPE_LEVEL_GENERIC 0x7fffffff
+
+/*
+ * Esquema de tipo: vars são as variáveis genéricas (nível
+ * TYPE_LEVEL_GENERIC) presentes em type. Com var_count == 0 o esquema é
+ * monomórfico e type é usado diretamente, sem cópia.
+ */
 typedef struct {
-    int *vars;
+    Type **vars;
     int var_count;
     Type *type;
 } TypeScheme;
 
-typedef struct EnvEntry {
-    char *name;
-    TypeScheme *scheme;
-    struct EnvEntry *next;
+/*
+ * Registro de desfazer do ambiente: cada declaração guarda a ligação que
+ * ela esconde, restaurada quando o escopo da declaração termina.
+ */
+typedef struct {
+    Atom name;
+    TypeScheme *shadowed;  // Ligação anterior do nome (NULL se não havia)
 } EnvEntry;
 
-void semantic_check(ASTNode *root);
+// Par de tipos na pilha de trabalho das travessias de tipos (ver semantic.c)
+typedef struct {
+    Type *a;
+    Type *b;
+} TypePair;
+
+// Estado de um nó em inferência (empilhado em paralelo ao percurso da AST)
+typedef struct {
+    size_t values;         // Onde começam os tipos dos filhos na pilha de valores
+    size_t scope;          // Marca do ambiente (blocos e funções)
+    Type *type;            // Tipo em construção (declarações e chamadas)
+    Type *outer_return;    // Contexto de retorno da função envolvente
+    int outer_return_count;
+} InferFrame;
+
+// Classes de tamanho (múltiplos de 8 bytes) com lista de blocos livres
+#define SEMANTIC_FREE_CLASSES 16
+
+// Tamanho da arena de tipos abaixo do qual ela nunca é coletada
+#define SEMANTIC_COLLECT_MIN_BYTES (1024 * 1024)
+
+/*
+ * Estado da inferência de tipos de uma compilação. Não há estado global,
+ * então compilações independentes podem rodar em paralelo.
+ *
+ * A inferência e as travessias de tipos usam pilhas explícitas (walk, frames,
+ * values e pairs), reaproveitadas entre comandos, em vez de recursão: a
+ * profundidade da AST ou de um tipo não consome a pilha nativa.
+ *
+ * Tipos, esquemas e entradas do ambiente vêm da arena types e são
+ * liberados juntos em semantic_free. Blocos temporários devolvidos antes
+ * disso ficam em free_blocks e são reaproveitados por alocações do mesmo
+ * tamanho. Entre comandos de nível superior, quando a arena dobra de tamanho,
+ * os esquemas ainda visíveis são copiados para uma arena nova e a antiga é
+ * liberada, então a memória acompanha as declarações vivas e não o número
+ * de comandos já verificados.
+ */
+typedef struct {
+    SymbolTable bindings;       // Átomo -> ligação visível (TypeScheme *)
+    EnvEntry *undo;             // Declarações ainda em escopo, da mais antiga à mais recente
+    size_t undo_count;
+    size_t undo_capacity;
+    Arena types;                // Memória de todos os objetos da inferência
+    size_t types_live;          // Tamanho de types logo após a última coleta
+    void *free_blocks[SEMANTIC_FREE_CLASSES]; // Blocos livres por classe de tamanho
+    int next_type_var;          // Próximo identificador de variável de tipo
+    int level;                  // Nível de let atual (generalização de Rémy)
+    Type **fun_types;           // Tipos de função compartilhados (endereçamento aberto)
+    size_t fun_count;
+    size_t fun_capacity;        // Potência de dois (0 antes do primeiro tipo)
+    Type *return_type;          // Tipo de retorno da função sendo verificada (ou NULL)
+    int return_count;           // Comandos return encontrados na função atual
+    ASTWalkStack walk;          // Percurso do comando em inferência
+    InferFrame *frames;         // Nós em inferência
+    size_t frame_count;
+    size_t frame_capacity;
+    Type **values;              // Tipos já inferidos e resultados parciais de cópias
+    size_t value_count;
+    size_t value_capacity;
+    TypePair *pairs;            // Trabalho pendente de unify, occurs_in, copy_type, etc.
+    size_t pair_count;
+    size_t pair_capacity;
+    const AtomTable *atoms;     // Nomes usados pela AST (para mensagens)
+    Diagnostics *diagnostics;   // Destino dos erros de tipo
+} SemanticState;
+
+/**
+ * Inicia uma verificação incremental, comando a comando.
+ *
+ * @param state Estado a inicializar.
+ * @param atoms Tabela com os nomes usados pela AST.
+ * @param diagnostics Destino dos erros. Erros de tipo são fatais
+ *                    (diagnostics_fatal), então o chamador deve registrar
+ *                    um ponto de recuperação antes de verificar comandos.
+ */
+void semantic_begin(SemanticState *state, const AtomTable *atoms, Diagnostics *diagnostics);
+
+/**
+ * Declara uma função predefinida (ver builtins.h) que recebe arity
+ * argumentos de qualquer tipo e devolve nil.
+ *
+ * @param state Estado da verificação.
+ * @param name Nome da função.
+ * @param arity Número de argumentos.
+ */
+void semantic_declare_builtin(SemanticState *state, Atom name, int arity);
+
+/**
+ * Infere os tipos de um comando de nível superior, no ambiente formado
+ * pelos comandos verificados antes dele desde semantic_begin.
+ *
+ * O ambiente guarda apenas os esquemas de tipo das declarações, então os
+ * nós do comando podem ser liberados após a chamada.
+ *
+ * @param state Estado da verificação.
+ * @param statement Comando de nível superior.
+ */
+void semantic_check_toplevel(SemanticState *state, ASTNode *statement);
+
+/**
+ * Libera o ambiente de tipos e, de uma vez, todos os objetos criados pela
+ * inferência.
+ *
+ * @param state Estado da verificação.
+ */
+void semantic_free(SemanticState *state);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,31 +1,83 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
-#include "types.h"
+#include "intern.h"
 
-#define MAX_SYMBOL_NAME_LEN 64
-
-typedef struct Symbol {
-    char name[MAX_SYMBOL_NAME_LEN];
-    DataType type;
-    struct Symbol *next; 
+/*
+ * Tabela de símbolos de um escopo: mapa de átomos para valores com
+ * endereçamento aberto (Robin Hood). Cada posição guarda o átomo, a
+ * distância até a posição ideal e o valor, então uma consulta percorre só
+ * posições contíguas e termina assim que encontra um símbolo mais perto da
+ * própria posição ideal que a chave procurada.
+ *
+ * Escopos podem ser encadeados por parent: symbol_table_lookup procura no
+ * escopo e depois nos escopos ancestrais.
+ */
+typedef struct {
+    Atom name;
+    unsigned int distance; // 1 + distância da posição ideal (0 = posição vazia)
+    void *value;
 } Symbol;
 
 typedef struct SymbolTable {
-    Symbol **symbols;
-    int size;
-    struct SymbolTable *parent; 
+    Symbol *slots;
+    unsigned int count;
+    unsigned int mask;     // Número de posições - 1 (potência de dois)
+    unsigned int shift;    // 32 - log2(número de posições), para o hash
+    struct SymbolTable *parent;
 } SymbolTable;
 
-SymbolTable *create_symbol_table(int size, SymbolTable *parent);
+/**
+ * Inicializa uma tabela vazia.
+ *
+ * @param table Tabela a inicializar.
+ * @param parent Escopo envolvente (ou NULL).
+ */
+void symbol_table_init(SymbolTable *table, SymbolTable *parent);
+
+/**
+ * Libera as posições da tabela (os valores pertencem ao chamador).
+ *
+ * @param table Tabela a liberar.
+ */
+void symbol_table_free(SymbolTable *table);
 
-void free_symbol_table(SymbolTable *table);
+/**
+ * Associa value a name neste escopo, substituindo uma associação anterior
+ * do mesmo escopo. A tabela cresce automaticamente.
+ *
+ * @param table Tabela do escopo.
+ * @param name Átomo do nome (diferente de ATOM_NONE).
+ * @param value Valor associado (diferente de NULL).
+ * @return Valor substituído ou NULL se o nome não estava no escopo.
+ */
+void *symbol_table_insert(SymbolTable *table, Atom name, void *value);
 
-void symbol_table_add(SymbolTable *table, const char *name, DataType type);
+/**
+ * Remove name deste escopo.
+ *
+ * @param table Tabela do escopo.
+ * @param name Átomo do nome.
+ * @return Valor removido ou NULL se o nome não estava no escopo.
+ */
+void *symbol_table_remove(SymbolTable *table, Atom name);
 
-Symbol *symbol_table_lookup(SymbolTable *table, const char *name);
+/**
+ * Procura name apenas neste escopo.
+ *
+ * @param table Tabela do escopo.
+ * @param name Átomo do nome.
+ * @return Valor associado ou NULL.
+ */
+void *symbol_table_lookup_local(const SymbolTable *table, Atom name);
 
-void symbol_table_exit_scope(SymbolTable *table);
-unsigned int symbol_hash(const char *name, int size);
+/**
+ * Procura name neste escopo e, se não houver, nos escopos ancestrais.
+ *
+ * @param table Tabela do escopo.
+ * @param name Átomo do nome.
+ * @return Valor do escopo mais interno que declara o nome, ou NULL.
+ */
+void *symbol_table_lookup(const SymbolTable *table, Atom name);
 
-#endif 
+#endif
@@ -0,0 +1,34 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Execução paralela de tarefas independentes numeradas de 0 a count - 1.
+ *
+ * Cada thread começa com uma faixa contígua de índices e consome a sua
+ * faixa pelo início. Quando ela se esgota, a thread rouba a metade final da
+ * faixa de outra thread (work stealing), então tarefas de custo desigual
+ * (arquivos grandes e pequenos) se equilibram sem uma fila central.
+ */
+typedef void (*ThreadPoolTask)(void *context, size_t index);
+
+/**
+ * Executa task(context, i) para cada i em [0, count) usando até threads
+ * threads (incluindo a que chama). A função retorna quando todas as
+ * tarefas terminam. As tarefas podem executar em qualquer ordem.
+ *
+ * @param threads Número de threads (0 usa o número de processadores).
+ * @param count Número de tarefas.
+ * @param task Função executada para cada índice.
+ * @param context Argumento repassado a task.
+ * @return Número de threads efetivamente usadas.
+ */
+size_t thread_pool_run(size_t threads, size_t count, ThreadPoolTask task, void *context);
+
+/**
+ * Número de processadores disponíveis (pelo menos 1).
+ */
+size_t thread_pool_default_threads(void);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdio.h>
+#include "ir.h"
+#include "arena.h"
+#include "diagnostics.h"
+
+/*
+ * Máquina virtual que executa a IR (ver ir.h).
+ *
+ * Todos os quadros de chamada ficam em uma única pilha de valores,
+ * reservada uma vez no início da execução: os registradores de uma função
+ * chamada começam logo após o registrador da função na chamadora, então os
+ * argumentos já estão no lugar e uma chamada não aloca memória.
+ *
+ * Toda função é uma closure. Um upvalue aponta para o registrador da
+ * variável capturada enquanto ela está em escopo (aberto) e passa a guardar
+ * o valor quando ela sai (fechado); as closures que capturam a mesma
+ * variável compartilham o upvalue. Closures e upvalues vivem até o fim da
+ * execução, como as strings.
+ *
+ * O despacho usa goto computado (direct threading) quando o compilador
+ * oferece rótulos como valores; compile com -DVM_SWITCH_DISPATCH para usar
+ * o switch portável.
+ */
+#define VM_STACK_SIZE (1 << 20)   // Valores na pilha
+#define VM_MAX_CALLS (1 << 18)    // Chamadas aninhadas
+
+typedef enum {
+    VM_NIL,
+    VM_BOOLEAN,
+    VM_NUMBER,
+    VM_STRING,
+    VM_FUNCTION,
+    VM_BUILTIN
+} VMValueType;
+
+// Strings não são modificadas; as criadas na execução vivem até o fim dela
+typedef struct {
+    size_t length;
+    char chars[];
+} VMString;
+
+struct VMClosure;
+
+typedef struct {
+    VMValueType type;
+    union {
+        int boolean;
+        double number;
+        const VMString *string;
+        struct VMClosure *closure; // VM_FUNCTION
+        unsigned int function;     // VM_BUILTIN: Builtin
+    };
+} VMValue;
+
+typedef struct VMUpvalue {
+    VMValue *value;              // Registrador da variável (aberto) ou &closed (fechado)
+    VMValue closed;
+    struct VMUpvalue *next;      // Próximo upvalue aberto, em registrador mais baixo
+} VMUpvalue;
+
+typedef struct VMClosure {
+    unsigned int function;
+    unsigned int upvalue_count;
+    VMUpvalue *upvalues[];
+} VMClosure;
+
+// Função pronta para execução: as constantes já convertidas em valores
+typedef struct {
+    const IRInstruction *code;
+    const unsigned int *lines;
+    VMValue *constants;
+    int param_count;
+    int register_count;
+    Atom name;
+    const IRUpvalue *upvalues;   // Variáveis capturadas por IR_CLOSURE
+    unsigned int upvalue_count;
+    VMClosure *closure;          // Closure sem upvalues (constantes da função)
+} VMFunction;
+
+typedef struct {
+    const IRInstruction *pc;     // Próxima instrução da função ao retornar para ela
+    VMValue *base;               // Primeiro registrador do quadro
+    VMClosure *closure;
+} VMCallInfo;
+
+typedef struct {
+    const IRProgram *program;
+    const AtomTable *atoms;
+    VMFunction *functions;
+    VMValue *globals;
+    VMValue *stack;
+    VMCallInfo *calls;
+    Arena strings;               // Strings das constantes e criadas na execução
+    Arena closures;              // Closures e upvalues
+    VMUpvalue *open_upvalues;    // Do registrador mais alto ao mais baixo
+    FILE *out;                   // Saída de print
+    Diagnostics *diagnostics;
+} VM;
+
+/**
+ * Prepara a execução de um programa completo (encerrado por lower_finish).
+ *
+ * @param vm Máquina a inicializar.
+ * @param program Programa a executar (deve permanecer válido).
+ * @param atoms Tabela de átomos da compilação.
+ * @param diagnostics Destino dos erros de execução.
+ */
+void vm_init(VM *vm, const IRProgram *program, const AtomTable *atoms, Diagnostics *diagnostics);
+
+/**
+ * Libera a pilha, as globais, as strings e as closures da execução.
+ *
+ * @param vm Máquina a liberar.
+ */
+void vm_free(VM *vm);
+
+/**
+ * Executa o código de nível superior do programa.
+ *
+ * @param vm Máquina inicializada.
+ * @return 0 se o programa terminou, 1 em erro de execução (descrito em diagnostics).
+ */
+int vm_run(VM *vm);
+
+#endif
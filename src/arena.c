@@ -0,0 +1,72 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGNMENT 8
+
+static size_t arena_align(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena *arena, size_t chunk_size) {
+    arena->head = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->bytes_allocated = 0;
+}
+
+// Abre um novo bloco com pelo menos min_size bytes livres
+static ArenaChunk *arena_new_chunk(Arena *arena, size_t min_size) {
+    size_t size = arena->chunk_size;
+    while (size < min_size) {
+        size *= 2;
+    }
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size);
+    if (!chunk) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    chunk->next = arena->head;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->head = chunk;
+    arena->bytes_allocated += sizeof(ArenaChunk) + size;
+    return chunk;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = arena_align(size);
+    ArenaChunk *chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = arena_new_chunk(arena, size);
+    }
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void arena_reset(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    if (!chunk) {
+        return;
+    }
+    ArenaChunk *old = chunk->next;
+    while (old) {
+        ArenaChunk *next = old->next;
+        free(old);
+        old = next;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+    arena->bytes_allocated = sizeof(ArenaChunk) + chunk->size;
+}
+
+void arena_release(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->bytes_allocated = 0;
+}
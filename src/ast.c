@@ -1,208 +1,412 @@
 #include "ast.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
-ASTNode *create_number_node(const char *value)
+#define AST_PAYLOAD_OFFSET offsetof(ASTNode, number)
+#define AST_NODE_SIZE(member) (AST_PAYLOAD_OFFSET + sizeof(((ASTNode *)0)->member))
+
+// Falha a compilação se a condição for falsa
+#define AST_STATIC_ASSERT(cond, name) typedef char ast_static_assert_##name[(cond) ? 1 : -1]
+
+/*
+ * Layout travado: o cabeçalho tem 16 bytes e nenhum nó passa de 40 bytes.
+ * Se uma mudança quebrar estas verificações, o custo por nó de toda AST
+ * cresce junto; ajuste os limites apenas de propósito.
+ */
+AST_STATIC_ASSERT(AST_PAYLOAD_OFFSET == 16, header_is_16_bytes);
+AST_STATIC_ASSERT(sizeof(ASTNode) <= 40, node_is_at_most_40_bytes);
+AST_STATIC_ASSERT(AST_NODE_SIZE(number) <= 24, number_node_is_24_bytes);
+AST_STATIC_ASSERT(AST_NODE_SIZE(variable) <= 24, variable_node_is_24_bytes);
+AST_STATIC_ASSERT(AST_NODE_SIZE(binary_op) <= 40, binary_op_node_is_40_bytes);
+
+static const unsigned char ast_node_sizes[AST_NODE_TYPE_COUNT] = {
+    [AST_NUMBER] = AST_NODE_SIZE(number),
+    [AST_STRING] = AST_NODE_SIZE(string),
+    [AST_VARIABLE] = AST_NODE_SIZE(variable),
+    [AST_BINARY_OP] = AST_NODE_SIZE(binary_op),
+    [AST_UNARY_OP] = AST_NODE_SIZE(unary_op),
+    [AST_ASSIGNMENT] = AST_NODE_SIZE(assignment),
+    [AST_IF_STATEMENT] = AST_NODE_SIZE(if_statement),
+    [AST_WHILE_STATEMENT] = AST_NODE_SIZE(while_statement),
+    [AST_FUNCTION_CALL] = AST_NODE_SIZE(function_call),
+    [AST_FUNCTION_DECLARATION] = AST_NODE_SIZE(function_declaration),
+    [AST_FUNCTION_PARAMETER] = AST_NODE_SIZE(function_parameter),
+    [AST_RETURN_STATEMENT] = AST_NODE_SIZE(return_statement),
+    [AST_BLOCK] = AST_NODE_SIZE(block),
+    [AST_VARIABLE_DECLARATION] = AST_NODE_SIZE(variable_declaration),
+};
+
+size_t ast_node_size(ASTNodeType type)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_NUMBER;
-    node->data_type = TYPE_NUMBER;
-    strncpy(node->number.value, value, MAX_TOKEN_LEN);
+    return ast_node_sizes[type];
+}
+
+// Reserva na arena um nó com o tamanho exato do seu tipo
+static ASTNode *ast_alloc(Arena *arena, ASTNodeType type, DataType data_type)
+{
+    ASTNode *node = arena_alloc(arena, ast_node_sizes[type]);
+    node->type = (unsigned char)type;
+    node->data_type = (unsigned char)data_type;
+    node->reserved = 0;
+    node->offset = 0;
+    node->length = 0;
+    node->line = 0;
     return node;
 }
 
-ASTNode *create_variable_declaration_node(const char *name, const char *type_name, ASTNode *expression)
+ASTNode *create_number_node(Arena *arena, double value)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_VARIABLE_DECLARATION;
-    node->data_type = TYPE_UNKNOWN;
-    strncpy(node->variable_declaration.name, name, MAX_TOKEN_LEN);
-    strncpy(node->variable_declaration.type_name, type_name, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_NUMBER, TYPE_NUMBER);
+    node->number.value = value;
+    return node;
+}
+
+ASTNode *create_variable_declaration_node(Arena *arena, Atom name, Atom type_name, ASTNode *expression)
+{
+    ASTNode *node = ast_alloc(arena, AST_VARIABLE_DECLARATION, TYPE_UNKNOWN);
+    node->variable_declaration.name = name;
+    node->variable_declaration.type_name = type_name;
     node->variable_declaration.expression = expression;
     return node;
 }
 
-ASTNode *create_string_node(const char *value)
+ASTNode *create_string_node(Arena *arena, Atom value)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_STRING;
-    node->data_type = TYPE_STRING;
-    strncpy(node->string.value, value, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_STRING, TYPE_STRING);
+    node->string.value = value;
     return node;
 }
 
-ASTNode *create_variable_node(const char *name)
+ASTNode *create_variable_node(Arena *arena, Atom name)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_VARIABLE;
-    node->data_type = TYPE_UNKNOWN;
-    strncpy(node->variable.name, name, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_VARIABLE, TYPE_UNKNOWN);
+    node->variable.name = name;
     return node;
 }
 
-ASTNode *create_binary_op_node(const char *operator, ASTNode * left, ASTNode *right)
+ASTNode *create_binary_op_node(Arena *arena, OpKind op, ASTNode * left, ASTNode *right)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_BINARY_OP;
-    node->data_type = TYPE_UNKNOWN;
-    strncpy(node->binary_op.operator, operator, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_BINARY_OP, TYPE_UNKNOWN);
+    node->binary_op.op = op;
     node->binary_op.left = left;
     node->binary_op.right = right;
     return node;
 }
 
-ASTNode *create_assignment_node(ASTNode *variable, ASTNode *expression)
+ASTNode *create_unary_op_node(Arena *arena, OpKind op, ASTNode *operand)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_ASSIGNMENT;
-    node->data_type = TYPE_UNKNOWN;
+    ASTNode *node = ast_alloc(arena, AST_UNARY_OP, TYPE_UNKNOWN);
+    node->unary_op.op = op;
+    node->unary_op.operand = operand;
+    return node;
+}
+
+ASTNode *create_assignment_node(Arena *arena, ASTNode *variable, ASTNode *expression)
+{
+    ASTNode *node = ast_alloc(arena, AST_ASSIGNMENT, TYPE_UNKNOWN);
     node->assignment.variable = variable;
     node->assignment.expression = expression;
     return node;
 }
 
-ASTNode *create_if_statement_node(ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch)
+ASTNode *create_if_statement_node(Arena *arena, ASTNode *condition, ASTNode *then_branch, ASTNode *else_branch)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_IF_STATEMENT;
-    node->data_type = TYPE_UNKNOWN;
+    ASTNode *node = ast_alloc(arena, AST_IF_STATEMENT, TYPE_UNKNOWN);
     node->if_statement.condition = condition;
     node->if_statement.then_branch = then_branch;
     node->if_statement.else_branch = else_branch;
     return node;
 }
 
-ASTNode *create_while_statement_node(ASTNode *condition, ASTNode *body)
+ASTNode *create_while_statement_node(Arena *arena, ASTNode *condition, ASTNode *body)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_WHILE_STATEMENT;
-    node->data_type = TYPE_UNKNOWN;
+    ASTNode *node = ast_alloc(arena, AST_WHILE_STATEMENT, TYPE_UNKNOWN);
     node->while_statement.condition = condition;
     node->while_statement.body = body;
     return node;
 }
 
-ASTNode *create_function_call_node(const char *function_name, ASTNode **arguments, int arg_count)
+ASTNode *create_function_call_node(Arena *arena, Atom function_name, ASTNode **arguments, int arg_count)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_FUNCTION_CALL;
-    node->data_type = TYPE_UNKNOWN;
-    strncpy(node->function_call.function_name, function_name, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_FUNCTION_CALL, TYPE_UNKNOWN);
+    node->function_call.function_name = function_name;
     node->function_call.arguments = arguments;
     node->function_call.arg_count = arg_count;
     return node;
 }
 
-ASTNode *create_function_declaration_node(const char *name, ASTNode **parameters, int param_count, ASTNode *body)
+ASTNode *create_function_declaration_node(Arena *arena, Atom name, ASTNode **parameters, int param_count, ASTNode *body)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_FUNCTION_DECLARATION;
-    node->data_type = TYPE_FUNCTION;
-    strncpy(node->function_declaration.name, name, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_FUNCTION_DECLARATION, TYPE_FUNCTION);
+    node->function_declaration.name = name;
     node->function_declaration.parameters = parameters;
     node->function_declaration.param_count = param_count;
     node->function_declaration.body = body;
     return node;
 }
 
-ASTNode *create_function_parameter_node(const char *name)
+ASTNode *create_function_parameter_node(Arena *arena, Atom name)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_FUNCTION_PARAMETER;
-    node->data_type = TYPE_UNKNOWN;
-    strncpy(node->function_parameter.name, name, MAX_TOKEN_LEN);
+    ASTNode *node = ast_alloc(arena, AST_FUNCTION_PARAMETER, TYPE_UNKNOWN);
+    node->function_parameter.name = name;
     return node;
 }
 
-ASTNode *create_return_statement_node(ASTNode *expression)
+ASTNode *create_return_statement_node(Arena *arena, ASTNode *expression)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_RETURN_STATEMENT;
-    node->data_type = TYPE_UNKNOWN;
+    ASTNode *node = ast_alloc(arena, AST_RETURN_STATEMENT, TYPE_UNKNOWN);
     node->return_statement.expression = expression;
     return node;
 }
 
-ASTNode *create_block_node()
+ASTNode *create_block_node(Arena *arena)
 {
-    ASTNode *node = malloc(sizeof(ASTNode));
-    if (!node)
-    {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
-    }
-    node->type = AST_BLOCK;
-    node->data_type = TYPE_UNKNOWN;
+    ASTNode *node = ast_alloc(arena, AST_BLOCK, TYPE_UNKNOWN);
     node->block.statements = NULL;
     node->block.statement_count = 0;
     return node;
 }
 
-void print_ast(ASTNode *node, int indent)
+/*
+ * Onde ficam os filhos de cada tipo de nó: até três campos ASTNode* fixos
+ * e, opcionalmente, um vetor de filhos com o seu contador. Os deslocamentos
+ * são relativos ao início do nó; list == 0 indica que não há vetor (o
+ * deslocamento 0 é o cabeçalho, nunca um vetor). Em list_first, o vetor
+ * vem antes dos campos fixos (parâmetros antes do corpo).
+ */
+typedef struct
 {
-    if (!node)
-        return;
+    unsigned char fixed_count;
+    unsigned char list_first;
+    unsigned short fixed[3];
+    unsigned short list;
+    unsigned short list_count;
+} ASTChildLayout;
+
+#define AST_FIELD(member) ((unsigned short)offsetof(ASTNode, member))
+
+static const ASTChildLayout ast_child_layouts[AST_NODE_TYPE_COUNT] = {
+    [AST_BINARY_OP] = {2, 0, {AST_FIELD(binary_op.left), AST_FIELD(binary_op.right)}, 0, 0},
+    [AST_UNARY_OP] = {1, 0, {AST_FIELD(unary_op.operand)}, 0, 0},
+    [AST_ASSIGNMENT] = {2, 0, {AST_FIELD(assignment.variable), AST_FIELD(assignment.expression)}, 0, 0},
+    [AST_IF_STATEMENT] = {3, 0,
+                          {AST_FIELD(if_statement.condition), AST_FIELD(if_statement.then_branch),
+                           AST_FIELD(if_statement.else_branch)},
+                          0, 0},
+    [AST_WHILE_STATEMENT] = {2, 0, {AST_FIELD(while_statement.condition), AST_FIELD(while_statement.body)}, 0, 0},
+    [AST_FUNCTION_CALL] = {0, 0, {0}, AST_FIELD(function_call.arguments), AST_FIELD(function_call.arg_count)},
+    [AST_FUNCTION_DECLARATION] = {1, 1, {AST_FIELD(function_declaration.body)},
+                                  AST_FIELD(function_declaration.parameters),
+                                  AST_FIELD(function_declaration.param_count)},
+    [AST_RETURN_STATEMENT] = {1, 0, {AST_FIELD(return_statement.expression)}, 0, 0},
+    [AST_BLOCK] = {0, 0, {0}, AST_FIELD(block.statements), AST_FIELD(block.statement_count)},
+    [AST_VARIABLE_DECLARATION] = {1, 0, {AST_FIELD(variable_declaration.expression)}, 0, 0},
+};
+
+static inline int ast_list_count(const ASTNode *node, const ASTChildLayout *layout)
+{
+    if (!layout->list)
+        return 0;
+    return *(const int *)((const char *)node + layout->list_count);
+}
+
+int ast_child_count(const ASTNode *node)
+{
+    const ASTChildLayout *layout = &ast_child_layouts[node->type];
+    return layout->fixed_count + ast_list_count(node, layout);
+}
+
+ASTNode *ast_child(const ASTNode *node, int index)
+{
+    const ASTChildLayout *layout = &ast_child_layouts[node->type];
+    int list_count = ast_list_count(node, layout);
+    int list_start = layout->list_first ? 0 : layout->fixed_count;
+    int fixed_start = layout->list_first ? list_count : 0;
+
+    if (index >= list_start && index < list_start + list_count)
+    {
+        ASTNode *const *list = *(ASTNode *const *const *)((const char *)node + layout->list);
+        return list[index - list_start];
+    }
+    if (index >= fixed_start && index < fixed_start + layout->fixed_count)
+        return *(ASTNode *const *)((const char *)node + layout->fixed[index - fixed_start]);
+    return NULL;
+}
+
+static void ast_walk_push(ASTWalkStack *stack, ASTNode *node, int index)
+{
+    if (stack->count == stack->capacity)
+    {
+        stack->capacity = stack->capacity ? stack->capacity * 2 : 64;
+        stack->frames = realloc(stack->frames, stack->capacity * sizeof(ASTWalkFrame));
+        if (!stack->frames)
+        {
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
+        }
+    }
+    ASTWalkFrame *frame = &stack->frames[stack->count++];
+    frame->node = node;
+    frame->index = index;
+    frame->next = 0;
+}
+
+// Chama os ganchos pre em ordem; o resultado mais forte prevalece
+static ASTVisitResult ast_walk_pre(const ASTVisitor *visitors, int visitor_count, const ASTVisit *visit)
+{
+    ASTVisitResult result = AST_VISIT_CONTINUE;
+    for (int i = 0; i < visitor_count; i++)
+    {
+        if (!visitors[i].pre)
+            continue;
+        ASTVisitResult r = visitors[i].pre(visitors[i].context, visit);
+        if (r == AST_VISIT_STOP)
+            return r;
+        if (r == AST_VISIT_SKIP)
+            result = r;
+    }
+    return result;
+}
+
+static ASTVisitResult ast_walk_post(const ASTVisitor *visitors, int visitor_count, const ASTVisit *visit)
+{
+    for (int i = visitor_count - 1; i >= 0; i--)
+    {
+        if (visitors[i].post && visitors[i].post(visitors[i].context, visit) == AST_VISIT_STOP)
+            return AST_VISIT_STOP;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+/*
+ * Cada nó é empilhado depois dos seus ganchos pre e desempilhado antes dos
+ * post. Um nó cujos filhos foram pulados começa com next no fim da lista.
+ */
+int ast_walk(ASTNode *root, const ASTVisitor *visitors, int visitor_count, ASTWalkStack *stack)
+{
+    ASTWalkStack local = {NULL, 0, 0};
+    if (!stack)
+        stack = &local;
+    size_t base = stack->count;
+
+    ASTVisit visit = {root, NULL, 0, 0};
+    ASTVisitResult result = ast_walk_pre(visitors, visitor_count, &visit);
+    if (result == AST_VISIT_STOP)
+        goto stop;
+    ast_walk_push(stack, root, 0);
+    if (result == AST_VISIT_SKIP)
+        stack->frames[stack->count - 1].next = ast_child_count(root);
+
+    while (stack->count > base)
+    {
+        ASTWalkFrame *frame = &stack->frames[stack->count - 1];
+        int count = ast_child_count(frame->node);
+        ASTNode *child = NULL;
+        while (!child && frame->next < count)
+            child = ast_child(frame->node, frame->next++);
+
+        if (child)
+        {
+            visit.node = child;
+            visit.parent = frame->node;
+            visit.index = frame->next - 1;
+            visit.depth = (int)(stack->count - base);
+            result = ast_walk_pre(visitors, visitor_count, &visit);
+            if (result == AST_VISIT_STOP)
+                goto stop;
+            ast_walk_push(stack, child, visit.index);
+            if (result == AST_VISIT_SKIP)
+                stack->frames[stack->count - 1].next = ast_child_count(child);
+            continue;
+        }
+
+        stack->count--;
+        visit.node = frame->node;
+        visit.parent = stack->count > base ? stack->frames[stack->count - 1].node : NULL;
+        visit.index = frame->index;
+        visit.depth = (int)(stack->count - base);
+        if (ast_walk_post(visitors, visitor_count, &visit) == AST_VISIT_STOP)
+            goto stop;
+    }
+    ast_walk_stack_free(&local);
+    return 1;
+
+stop:
+    stack->count = base;
+    ast_walk_stack_free(&local);
+    return 0;
+}
+
+void ast_walk_stack_free(ASTWalkStack *stack)
+{
+    free(stack->frames);
+    stack->frames = NULL;
+    stack->count = 0;
+    stack->capacity = 0;
+}
+
+/*
+ * Impressão: o recuo de cada nó é guardado por profundidade, e os rótulos
+ * ("Condition:", "Body:", ...) que antecedem os filhos de um comando são
+ * impressos ao entrar no filho correspondente.
+ */
+typedef struct
+{
+    const AtomTable *atoms;
+    int root_indent;
+    int *indents;          // Recuo do nó visitado em cada profundidade
+    size_t capacity;
+} PrintContext;
+
+// Rótulo impresso antes do filho index de parent, ou NULL
+static const char *print_label(const ASTNode *parent, int index)
+{
+    switch (parent->type)
+    {
+    case AST_IF_STATEMENT:
+        return index == 0 ? "Condition:" : index == 1 ? "Then:" : "Else:";
+    case AST_WHILE_STATEMENT:
+        return index == 0 ? "Condition:" : "Body:";
+    case AST_FUNCTION_DECLARATION:
+        // "Parameters:" é impresso junto com a declaração, mesmo sem parâmetros
+        return index == parent->function_declaration.param_count ? "Body:" : NULL;
+    default:
+        return NULL;
+    }
+}
+
+static ASTVisitResult print_node(void *context, const ASTVisit *visit)
+{
+    PrintContext *print = context;
+    const AtomTable *atoms = print->atoms;
+    ASTNode *node = visit->node;
+    int indent = print->root_indent;
+
+    if (visit->parent)
+    {
+        // Filhos de comandos com rótulos ficam um nível abaixo do rótulo
+        int parent_indent = print->indents[visit->depth - 1];
+        const char *label = print_label(visit->parent, visit->index);
+        int labeled = visit->parent->type == AST_IF_STATEMENT || visit->parent->type == AST_WHILE_STATEMENT ||
+                      visit->parent->type == AST_FUNCTION_DECLARATION;
+        if (label)
+            printf("%*s%s\n", (parent_indent + 1) * 2, "", label);
+        indent = parent_indent + (labeled ? 2 : 1);
+    }
+
+    if ((size_t)visit->depth >= print->capacity)
+    {
+        print->capacity = print->capacity ? print->capacity * 2 : 64;
+        print->indents = realloc(print->indents, print->capacity * sizeof(int));
+        if (!print->indents)
+        {
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
+        }
+    }
+    print->indents[visit->depth] = indent;
 
     for (int i = 0; i < indent; i++)
         printf("  ");
@@ -210,155 +414,73 @@ void print_ast(ASTNode *node, int indent)
     switch (node->type)
     {
     case AST_NUMBER:
-        printf("Number(%s)\n", node->number.value);
+        printf("Number(%g)\n", node->number.value);
         break;
     case AST_STRING:
-        printf("String(\"%s\")\n", node->string.value);
+        printf("String(\"%s\")\n", atom_name(atoms, node->string.value));
         break;
     case AST_VARIABLE:
-        printf("Variable(%s)\n", node->variable.name);
+        printf("Variable(%s)\n", atom_name(atoms, node->variable.name));
         break;
     case AST_BINARY_OP:
-        printf("BinaryOp(%s)\n", node->binary_op.operator);
-        print_ast(node->binary_op.left, indent + 1);
-        print_ast(node->binary_op.right, indent + 1);
+        printf("BinaryOp(%s)\n", op_name(node->binary_op.op));
+        break;
+    case AST_UNARY_OP:
+        printf("UnaryOp(%s)\n", op_name(node->unary_op.op));
         break;
     case AST_ASSIGNMENT:
         printf("Assignment\n");
-        print_ast(node->assignment.variable, indent + 1);
-        print_ast(node->assignment.expression, indent + 1);
         break;
     case AST_IF_STATEMENT:
         printf("IfStatement\n");
-        printf("%*sCondition:\n", (indent + 1) * 2, "");
-        print_ast(node->if_statement.condition, indent + 2);
-        printf("%*sThen:\n", (indent + 1) * 2, "");
-        print_ast(node->if_statement.then_branch, indent + 2);
-        if (node->if_statement.else_branch)
-        {
-            printf("%*sElse:\n", (indent + 1) * 2, "");
-            print_ast(node->if_statement.else_branch, indent + 2);
-        }
         break;
     case AST_WHILE_STATEMENT:
         printf("WhileStatement\n");
-        printf("%*sCondition:\n", (indent + 1) * 2, "");
-        print_ast(node->while_statement.condition, indent + 2);
-        printf("%*sBody:\n", (indent + 1) * 2, "");
-        print_ast(node->while_statement.body, indent + 2);
         break;
     case AST_FUNCTION_CALL:
-        printf("FunctionCall(%s)\n", node->function_call.function_name);
-        for (int i = 0; i < node->function_call.arg_count; i++)
-        {
-            print_ast(node->function_call.arguments[i], indent + 1);
-        }
+        printf("FunctionCall(%s)\n", atom_name(atoms, node->function_call.function_name));
         break;
     case AST_FUNCTION_DECLARATION:
-        printf("FunctionDeclaration(%s)\n", node->function_declaration.name);
-        printf("%*sParameters:\n", (indent + 1) * 2, "");
-        for (int i = 0; i < node->function_declaration.param_count; i++)
-        {
-            print_ast(node->function_declaration.parameters[i], indent + 2);
-        }
-        printf("%*sBody:\n", (indent + 1) * 2, "");
-        print_ast(node->function_declaration.body, indent + 2);
+        printf("FunctionDeclaration(%s)\n", atom_name(atoms, node->function_declaration.name));
+        printf("%*s%s\n", (indent + 1) * 2, "", "Parameters:");
         break;
     case AST_FUNCTION_PARAMETER:
-        printf("Parameter(%s)\n", node->function_parameter.name);
+        printf("Parameter(%s)\n", atom_name(atoms, node->function_parameter.name));
         break;
     case AST_RETURN_STATEMENT:
         printf("ReturnStatement\n");
-        if (node->return_statement.expression)
-        {
-            print_ast(node->return_statement.expression, indent + 1);
-        }
         break;
     case AST_BLOCK:
         printf("Block\n");
-        for (int i = 0; i < node->block.statement_count; i++)
-        {
-            print_ast(node->block.statements[i], indent + 1);
-        }
         break;
     case AST_VARIABLE_DECLARATION:
-        printf("VariableDeclaration(name: %s", node->variable_declaration.name);
-        if (strlen(node->variable_declaration.type_name) > 0)
+        printf("VariableDeclaration(name: %s", atom_name(atoms, node->variable_declaration.name));
+        if (node->variable_declaration.type_name != ATOM_NONE)
         {
-            printf(", type: %s", node->variable_declaration.type_name);
+            printf(", type: %s", atom_name(atoms, node->variable_declaration.type_name));
         }
         printf(")\n");
-        if (node->variable_declaration.expression)
-        {
-            print_ast(node->variable_declaration.expression, indent + 1);
-        }
         break;
     default:
         printf("Unknown node type\n");
         break;
     }
+    return AST_VISIT_CONTINUE;
 }
 
-void free_ast(ASTNode *node)
+void print_ast(ASTNode *root, const AtomTable *atoms, int root_indent)
 {
-    if (!node)
+    if (!root)
         return;
+    PrintContext print = {atoms, root_indent, NULL, 0};
+    ASTVisitor visitor = {print_node, NULL, &print};
+    ast_walk(root, &visitor, 1, NULL);
+    free(print.indents);
+}
 
-    switch (node->type)
-    {
-    case AST_BINARY_OP:
-        free_ast(node->binary_op.left);
-        free_ast(node->binary_op.right);
-        break;
-    case AST_ASSIGNMENT:
-        free_ast(node->assignment.variable);
-        free_ast(node->assignment.expression);
-        break;
-    case AST_IF_STATEMENT:
-        free_ast(node->if_statement.condition);
-        free_ast(node->if_statement.then_branch);
-        if (node->if_statement.else_branch)
-            free_ast(node->if_statement.else_branch);
-        break;
-    case AST_WHILE_STATEMENT:
-        free_ast(node->while_statement.condition);
-        free_ast(node->while_statement.body);
-        break;
-    case AST_FUNCTION_CALL:
-        for (int i = 0; i < node->function_call.arg_count; i++)
-        {
-            free_ast(node->function_call.arguments[i]);
-        }
-        free(node->function_call.arguments);
-        break;
-    case AST_FUNCTION_DECLARATION:
-        for (int i = 0; i < node->function_declaration.param_count; i++)
-        {
-            free_ast(node->function_declaration.parameters[i]);
-        }
-        free(node->function_declaration.parameters);
-        free_ast(node->function_declaration.body);
-        break;
-    case AST_RETURN_STATEMENT:
-        if (node->return_statement.expression)
-            free_ast(node->return_statement.expression);
-        break;
-    case AST_BLOCK:
-        for (int i = 0; i < node->block.statement_count; i++)
-        {
-            free_ast(node->block.statements[i]);
-        }
-        free(node->block.statements);
-        break;
-    case AST_VARIABLE_DECLARATION:
-        if (node->variable_declaration.expression)
-        {
-            free_ast(node->variable_declaration.expression);
-        }
-        break;
-    default:
-        break;
-    }
-
-    free(node);
+// Os nós e os vetores de filhos pertencem à arena da compilação e são
+// liberados juntos por arena_release; free_ast não precisa percorrer a árvore.
+void free_ast(ASTNode *node)
+{
+    (void)node;
 }
@@ -0,0 +1,18 @@
+#include "builtins.h"
+
+typedef struct {
+    const char *name;
+    int arity;
+} BuiltinInfo;
+
+static const BuiltinInfo builtins[BUILTIN_COUNT] = {
+    [BUILTIN_PRINT] = {"print", 1},
+};
+
+const char *builtin_name(Builtin builtin) {
+    return builtins[builtin].name;
+}
+
+int builtin_arity(Builtin builtin) {
+    return builtins[builtin].arity;
+}
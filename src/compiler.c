@@ -0,0 +1,146 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "compiler.h"
+#include <errno.h>
+#include <setjmp.h>
+#include <string.h>
+
+void compiler_init(CompilerContext *context) {
+    memset(context, 0, sizeof(*context));
+    atom_table_init(&context->atoms);
+    arena_init(&context->ast_arena, 0);
+    diagnostics_init(&context->diagnostics);
+}
+
+void compiler_free(CompilerContext *context) {
+    if (context->opened) {
+        if (context->lowering) {
+            lower_free(&context->lower);
+            ir_program_free(&context->program);
+        }
+        semantic_free(&context->semantic);
+        parser_free(&context->parser);
+        lexer_free(&context->lexer);
+    }
+    arena_release(&context->ast_arena);
+    atom_table_free(&context->atoms);
+    diagnostics_free(&context->diagnostics);
+    context->opened = 0;
+}
+
+// Liga o lexer já inicializado ao restante do contexto
+static void compiler_start(CompilerContext *context) {
+    context->lexer.atoms = &context->atoms;
+    context->lexer.diagnostics = &context->diagnostics;
+    context->lexer.debug_mode = context->debug_mode;
+    parser_init(&context->parser, &context->lexer, &context->ast_arena);
+    context->parser.debug_mode = context->debug_mode;
+    semantic_begin(&context->semantic, &context->atoms, &context->diagnostics);
+    if (context->lowering) {
+        ir_program_init(&context->program);
+        lower_begin(&context->lower, &context->program, &context->atoms, &context->diagnostics);
+    }
+    for (int b = 0; b < BUILTIN_COUNT; b++) {
+        const char *name = builtin_name((Builtin)b);
+        Atom atom = atom_intern(&context->atoms, name, strlen(name));
+        semantic_declare_builtin(&context->semantic, atom, builtin_arity((Builtin)b));
+        if (context->lowering) {
+            lower_declare_builtin(&context->lower, atom);
+        }
+    }
+    context->opened = 1;
+}
+
+CompilerStatus compiler_open_path(CompilerContext *context, const char *path) {
+    if (strcmp(path, "-") == 0) {
+        lexer_init(&context->lexer, stdin);
+    } else if (lexer_init_path(&context->lexer, path) != 0) {
+        char reason[128];
+        if (strerror_r(errno, reason, sizeof(reason)) != 0) {
+            strcpy(reason, "erro desconhecido");
+        }
+        diagnostics_report(&context->diagnostics, 0, 0, "Erro ao abrir o arquivo '%s': %s", path, reason);
+        context->failed = 1;
+        return COMPILER_ERROR;
+    }
+    compiler_start(context);
+    return COMPILER_OK;
+}
+
+CompilerStatus compiler_open_buffer(CompilerContext *context, const char *source, size_t length) {
+    lexer_init_buffer(&context->lexer, source, length);
+    compiler_start(context);
+    return COMPILER_OK;
+}
+
+/*
+ * Erros fatais do parser e do verificador voltam para o setjmp das funções
+ * abaixo. A partir daí o contexto fica marcado como falho: o estado parcial
+ * (pilha de rascunho, ambiente de tipos) não é mais confiável.
+ */
+static CompilerStatus compiler_fail(CompilerContext *context) {
+    context->diagnostics.recover = NULL;
+    context->parser.scratch_count = 0;
+    context->parser.operator_count = 0;
+    context->parser.depth = 0;
+    context->failed = 1;
+    return COMPILER_ERROR;
+}
+
+CompilerStatus compiler_next_statement(CompilerContext *context, ASTNode **statement) {
+    *statement = NULL;
+    if (!context->opened || context->failed) {
+        return COMPILER_ERROR;
+    }
+
+    jmp_buf recover;
+    arena_reset(&context->ast_arena);
+    context->diagnostics.recover = &recover;
+    if (setjmp(recover) != 0) {
+        return compiler_fail(context);
+    }
+
+    ASTNode *node = parse_next_toplevel(&context->parser);
+    if (node) {
+        semantic_check_toplevel(&context->semantic, node);
+        if (context->lowering) {
+            lower_statement(&context->lower, node);
+        }
+    } else if (context->lowering) {
+        lower_finish(&context->lower);
+    }
+    context->diagnostics.recover = NULL;
+
+    if (!node) {
+        return COMPILER_DONE;
+    }
+    *statement = node;
+    return COMPILER_OK;
+}
+
+CompilerStatus compiler_check(CompilerContext *context, ASTNode **program) {
+    *program = NULL;
+    if (!context->opened || context->failed) {
+        return COMPILER_ERROR;
+    }
+
+    jmp_buf recover;
+    context->diagnostics.recover = &recover;
+    if (setjmp(recover) != 0) {
+        return compiler_fail(context);
+    }
+
+    ASTNode *root = parse(&context->parser);
+    semantic_check_toplevel(&context->semantic, root);
+    if (context->lowering) {
+        // Os comandos do bloco são traduzidos como comandos de nível superior
+        for (int i = 0; i < root->block.statement_count; i++) {
+            lower_statement(&context->lower, root->block.statements[i]);
+        }
+        lower_finish(&context->lower);
+    }
+    context->diagnostics.recover = NULL;
+
+    *program = root;
+    return COMPILER_OK;
+}
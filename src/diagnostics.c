@@ -0,0 +1,75 @@
+#include "diagnostics.h"
+#include <stdlib.h>
+#include <string.h>
+
+void diagnostics_init(Diagnostics *diagnostics) {
+    diagnostics->items = NULL;
+    diagnostics->count = 0;
+    diagnostics->capacity = 0;
+    diagnostics->recover = NULL;
+}
+
+void diagnostics_free(Diagnostics *diagnostics) {
+    for (size_t i = 0; i < diagnostics->count; i++) {
+        free(diagnostics->items[i].message);
+    }
+    free(diagnostics->items);
+    diagnostics->items = NULL;
+    diagnostics->count = diagnostics->capacity = 0;
+}
+
+void diagnostics_vreport(Diagnostics *diagnostics, int line, int column, const char *format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    char *message = malloc(length > 0 ? (size_t)length + 1 : 1);
+    if (!message) {
+        return;
+    }
+    vsnprintf(message, (size_t)length + 1, format, args);
+
+    if (diagnostics->count == diagnostics->capacity) {
+        size_t capacity = diagnostics->capacity ? diagnostics->capacity * 2 : 8;
+        Diagnostic *items = realloc(diagnostics->items, capacity * sizeof(Diagnostic));
+        if (!items) {
+            free(message);
+            return;
+        }
+        diagnostics->items = items;
+        diagnostics->capacity = capacity;
+    }
+    Diagnostic *diagnostic = &diagnostics->items[diagnostics->count++];
+    diagnostic->line = line;
+    diagnostic->column = column;
+    diagnostic->message = message;
+}
+
+void diagnostics_report(Diagnostics *diagnostics, int line, int column, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    diagnostics_vreport(diagnostics, line, column, format, args);
+    va_end(args);
+}
+
+void diagnostics_fatal(Diagnostics *diagnostics, int line, int column, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    diagnostics_vreport(diagnostics, line, column, format, args);
+    va_end(args);
+    diagnostics_abort(diagnostics);
+}
+
+void diagnostics_abort(Diagnostics *diagnostics) {
+    if (!diagnostics->recover) {
+        abort();
+    }
+    longjmp(*diagnostics->recover, 1);
+}
+
+void diagnostics_print(const Diagnostics *diagnostics, FILE *out) {
+    for (size_t i = 0; i < diagnostics->count; i++) {
+        fprintf(out, "%s\n", diagnostics->items[i].message);
+    }
+}
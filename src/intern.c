@@ -0,0 +1,125 @@
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATOM_INITIAL_CAPACITY 256
+
+static void *intern_realloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (!result) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+// FNV-1a de 32 bits
+static unsigned int atom_hash(const char *text, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void atom_table_init(AtomTable *table) {
+    memset(table, 0, sizeof(*table));
+    table->capacity = ATOM_INITIAL_CAPACITY;
+    table->offsets = intern_realloc(NULL, table->capacity * sizeof(*table->offsets));
+    table->lengths = intern_realloc(NULL, table->capacity * sizeof(*table->lengths));
+    table->hashes = intern_realloc(NULL, table->capacity * sizeof(*table->hashes));
+    table->slot_mask = 2 * ATOM_INITIAL_CAPACITY - 1;
+    table->slots = calloc(table->slot_mask + 1, sizeof(*table->slots));
+    table->chars_capacity = 4096;
+    table->chars = intern_realloc(NULL, table->chars_capacity);
+
+    // ATOM_NONE: texto vazio, nunca inserido na tabela hash
+    table->chars[0] = '\0';
+    table->chars_length = 1;
+    table->offsets[0] = 0;
+    table->lengths[0] = 0;
+    table->hashes[0] = 0;
+    table->count = 1;
+    if (!table->slots) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void atom_table_free(AtomTable *table) {
+    free(table->chars);
+    free(table->offsets);
+    free(table->lengths);
+    free(table->hashes);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+// Dobra a tabela hash, reinserindo os átomos existentes
+static void atom_table_grow_slots(AtomTable *table) {
+    unsigned int mask = table->slot_mask * 2 + 1;
+    Atom *slots = calloc(mask + 1, sizeof(*slots));
+    if (!slots) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    for (Atom atom = 1; atom < table->count; atom++) {
+        unsigned int i = table->hashes[atom] & mask;
+        while (slots[i] != ATOM_NONE) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = atom;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_mask = mask;
+}
+
+Atom atom_intern(AtomTable *table, const char *text, size_t length) {
+    unsigned int hash = atom_hash(text, length);
+    unsigned int i = hash & table->slot_mask;
+    Atom atom;
+    while ((atom = table->slots[i]) != ATOM_NONE) {
+        if (table->hashes[atom] == hash && table->lengths[atom] == length &&
+            memcmp(table->chars + table->offsets[atom], text, length) == 0) {
+            return atom;
+        }
+        i = (i + 1) & table->slot_mask;
+    }
+
+    if (table->count == table->capacity) {
+        table->capacity *= 2;
+        table->offsets = intern_realloc(table->offsets, table->capacity * sizeof(*table->offsets));
+        table->lengths = intern_realloc(table->lengths, table->capacity * sizeof(*table->lengths));
+        table->hashes = intern_realloc(table->hashes, table->capacity * sizeof(*table->hashes));
+    }
+    while (table->chars_length + length + 1 > table->chars_capacity) {
+        table->chars_capacity *= 2;
+        table->chars = intern_realloc(table->chars, table->chars_capacity);
+    }
+
+    atom = table->count++;
+    table->offsets[atom] = (unsigned int)table->chars_length;
+    table->lengths[atom] = (unsigned int)length;
+    table->hashes[atom] = hash;
+    memcpy(table->chars + table->chars_length, text, length);
+    table->chars[table->chars_length + length] = '\0';
+    table->chars_length += length + 1;
+    table->slots[i] = atom;
+
+    // Mantém a ocupação da tabela hash abaixo de 50%
+    if (table->count * 2 > table->slot_mask + 1) {
+        atom_table_grow_slots(table);
+    }
+    return atom;
+}
+
+const char *atom_name(const AtomTable *table, Atom atom) {
+    return table->chars + table->offsets[atom];
+}
+
+size_t atom_length(const AtomTable *table, Atom atom) {
+    return table->lengths[atom];
+}
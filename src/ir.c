@@ -0,0 +1,318 @@
+#include "ir.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define IR_INITIAL_CODE 64
+#define IR_INITIAL_CONSTANTS 16
+
+static void *ir_realloc(void *ptr, size_t size) {
+    void *result = realloc(ptr, size);
+    if (!result) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+// Formato dos operandos de cada operação (para a listagem)
+typedef enum {
+    IR_FORMAT_A,
+    IR_FORMAT_AB,
+    IR_FORMAT_ABC,
+    IR_FORMAT_AC,
+    IR_FORMAT_ABX,
+    IR_FORMAT_SJ,
+    IR_FORMAT_AX
+} IRFormat;
+
+typedef struct {
+    const char *name;
+    IRFormat format;
+} IROpcodeInfo;
+
+static const IROpcodeInfo ir_opcodes[IR_OPCODE_COUNT] = {
+    [IR_MOVE] = {"MOVE", IR_FORMAT_AB},
+    [IR_LOADK] = {"LOADK", IR_FORMAT_ABX},
+    [IR_LOADNIL] = {"LOADNIL", IR_FORMAT_A},
+    [IR_GETGLOBAL] = {"GETGLOBAL", IR_FORMAT_ABX},
+    [IR_SETGLOBAL] = {"SETGLOBAL", IR_FORMAT_ABX},
+    [IR_GETUPVAL] = {"GETUPVAL", IR_FORMAT_AB},
+    [IR_SETUPVAL] = {"SETUPVAL", IR_FORMAT_AB},
+    [IR_CLOSURE] = {"CLOSURE", IR_FORMAT_ABX},
+    [IR_ADD] = {"ADD", IR_FORMAT_ABC},
+    [IR_SUB] = {"SUB", IR_FORMAT_ABC},
+    [IR_MUL] = {"MUL", IR_FORMAT_ABC},
+    [IR_DIV] = {"DIV", IR_FORMAT_ABC},
+    [IR_MOD] = {"MOD", IR_FORMAT_ABC},
+    [IR_POW] = {"POW", IR_FORMAT_ABC},
+    [IR_CONCAT] = {"CONCAT", IR_FORMAT_ABC},
+    [IR_EQ] = {"EQ", IR_FORMAT_ABC},
+    [IR_NE] = {"NE", IR_FORMAT_ABC},
+    [IR_LT] = {"LT", IR_FORMAT_ABC},
+    [IR_LE] = {"LE", IR_FORMAT_ABC},
+    [IR_LTN] = {"LTN", IR_FORMAT_ABC},
+    [IR_LEN] = {"LEN", IR_FORMAT_ABC},
+    [IR_NOT] = {"NOT", IR_FORMAT_AB},
+    [IR_NEG] = {"NEG", IR_FORMAT_AB},
+    [IR_TEST] = {"TEST", IR_FORMAT_AC},
+    [IR_JMP] = {"JMP", IR_FORMAT_SJ},
+    [IR_CALL] = {"CALL", IR_FORMAT_AB},
+    [IR_RETURN] = {"RETURN", IR_FORMAT_AB},
+    [IR_CLOSE] = {"CLOSE", IR_FORMAT_A},
+    [IR_EXTRAARG] = {"EXTRAARG", IR_FORMAT_AX},
+};
+
+const char *ir_opcode_name(IROpcode op) {
+    return op < IR_OPCODE_COUNT ? ir_opcodes[op].name : "?";
+}
+
+static void ir_function_init(IRFunction *function, Atom name, int param_count, unsigned int line) {
+    memset(function, 0, sizeof(*function));
+    function->name = name;
+    function->param_count = param_count;
+    function->register_count = param_count;
+    function->line = line;
+}
+
+static void ir_function_free(IRFunction *function) {
+    free(function->code);
+    free(function->lines);
+    free(function->constants);
+    free(function->constant_slots);
+    free(function->upvalues);
+    memset(function, 0, sizeof(*function));
+}
+
+void ir_program_init(IRProgram *program) {
+    program->functions = NULL;
+    program->function_count = 0;
+    program->function_capacity = 0;
+    program->global_count = 0;
+    ir_add_function(program, ATOM_NONE, 0, 0);
+}
+
+void ir_program_free(IRProgram *program) {
+    for (size_t i = 0; i < program->function_count; i++) {
+        ir_function_free(&program->functions[i]);
+    }
+    free(program->functions);
+    program->functions = NULL;
+    program->function_count = 0;
+    program->function_capacity = 0;
+    program->global_count = 0;
+}
+
+unsigned int ir_add_function(IRProgram *program, Atom name, int param_count, unsigned int line) {
+    if (program->function_count == program->function_capacity) {
+        program->function_capacity = program->function_capacity ? program->function_capacity * 2 : 8;
+        program->functions = ir_realloc(program->functions, program->function_capacity * sizeof(IRFunction));
+    }
+    ir_function_init(&program->functions[program->function_count], name, param_count, line);
+    return (unsigned int)program->function_count++;
+}
+
+size_t ir_emit(IRFunction *function, IRInstruction instruction, unsigned int line) {
+    if (function->code_count == function->code_capacity) {
+        function->code_capacity = function->code_capacity ? function->code_capacity * 2 : IR_INITIAL_CODE;
+        function->code = ir_realloc(function->code, function->code_capacity * sizeof(IRInstruction));
+        function->lines = ir_realloc(function->lines, function->code_capacity * sizeof(unsigned int));
+    }
+    function->code[function->code_count] = instruction;
+    function->lines[function->code_count] = line;
+    return function->code_count++;
+}
+
+void ir_emit_abx(IRFunction *function, IROpcode op, int a, unsigned int bx, unsigned int line) {
+    if (bx < IR_BX_EXTENDED) {
+        ir_emit(function, IR_MAKE_ABX(op, a, bx), line);
+        return;
+    }
+    ir_emit(function, IR_MAKE_ABX(op, a, IR_BX_EXTENDED), line);
+    ir_emit(function, IR_MAKE_AX(IR_EXTRAARG, bx), line);
+}
+
+// Hash da constante: o tipo mais os bits do valor (números comparam por bits)
+static unsigned int ir_constant_hash(const IRConstant *constant) {
+    uint64_t bits = 0;
+    switch (constant->kind) {
+        case IR_CONST_NUMBER:
+            memcpy(&bits, &constant->number, sizeof(bits));
+            break;
+        case IR_CONST_STRING:
+            bits = constant->string;
+            break;
+        case IR_CONST_FUNCTION:
+            bits = constant->function;
+            break;
+    }
+    // Inteiros pequenos em ponto flutuante só variam nos bits altos
+    bits ^= (bits >> 32) ^ ((uint64_t)constant->kind << 61);
+    bits *= 0x9E3779B97F4A7C15ull;
+    return (unsigned int)(bits >> 32);
+}
+
+static int ir_constant_equal(const IRConstant *a, const IRConstant *b) {
+    if (a->kind != b->kind) {
+        return 0;
+    }
+    switch (a->kind) {
+        case IR_CONST_NUMBER:
+            return memcmp(&a->number, &b->number, sizeof(double)) == 0;
+        case IR_CONST_STRING:
+            return a->string == b->string;
+        case IR_CONST_FUNCTION:
+            return a->function == b->function;
+    }
+    return 0;
+}
+
+// Dobra a tabela de constantes, reinserindo os índices existentes
+static void ir_constant_slots_grow(IRFunction *function) {
+    unsigned int size = function->constant_slots ? (function->constant_mask + 1) * 2 : IR_INITIAL_CONSTANTS * 2;
+    free(function->constant_slots);
+    function->constant_slots = calloc(size, sizeof(unsigned int));
+    if (!function->constant_slots) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    function->constant_mask = size - 1;
+    for (unsigned int i = 0; i < function->constant_count; i++) {
+        unsigned int slot = ir_constant_hash(&function->constants[i]) & function->constant_mask;
+        while (function->constant_slots[slot]) {
+            slot = (slot + 1) & function->constant_mask;
+        }
+        function->constant_slots[slot] = i + 1;
+    }
+}
+
+unsigned int ir_constant(IRFunction *function, IRConstant constant) {
+    // Carga máxima de 1/2
+    if (!function->constant_slots || (function->constant_count + 1) * 2 > function->constant_mask + 1) {
+        ir_constant_slots_grow(function);
+    }
+    unsigned int slot = ir_constant_hash(&constant) & function->constant_mask;
+    while (function->constant_slots[slot]) {
+        unsigned int index = function->constant_slots[slot] - 1;
+        if (ir_constant_equal(&function->constants[index], &constant)) {
+            return index;
+        }
+        slot = (slot + 1) & function->constant_mask;
+    }
+
+    if (function->constant_count == function->constant_capacity) {
+        function->constant_capacity = function->constant_capacity ? function->constant_capacity * 2 : IR_INITIAL_CONSTANTS;
+        function->constants = ir_realloc(function->constants, function->constant_capacity * sizeof(IRConstant));
+    }
+    function->constants[function->constant_count] = constant;
+    function->constant_slots[slot] = ++function->constant_count;
+    return function->constant_count - 1;
+}
+
+unsigned int ir_upvalue(IRFunction *function, IRUpvalue upvalue) {
+    // Poucos upvalues por função: a busca linear basta
+    for (unsigned int i = 0; i < function->upvalue_count; i++) {
+        if (function->upvalues[i].in_stack == upvalue.in_stack && function->upvalues[i].index == upvalue.index) {
+            return i;
+        }
+    }
+    if (function->upvalue_count == function->upvalue_capacity) {
+        function->upvalue_capacity = function->upvalue_capacity ? function->upvalue_capacity * 2 : 4;
+        function->upvalues = ir_realloc(function->upvalues, function->upvalue_capacity * sizeof(IRUpvalue));
+    }
+    function->upvalues[function->upvalue_count] = upvalue;
+    return function->upvalue_count++;
+}
+
+static void ir_print_constant(const IRProgram *program, const AtomTable *atoms, const IRConstant *constant, FILE *out) {
+    switch (constant->kind) {
+        case IR_CONST_NUMBER:
+            fprintf(out, "%g", constant->number);
+            break;
+        case IR_CONST_STRING:
+            fprintf(out, "\"%s\"", atom_name(atoms, constant->string));
+            break;
+        case IR_CONST_FUNCTION: {
+            Atom name = program->functions[constant->function].name;
+            fprintf(out, "function %s", atom_name(atoms, name));
+            break;
+        }
+    }
+}
+
+static void ir_print_function(const IRProgram *program, const AtomTable *atoms, unsigned int index, FILE *out) {
+    const IRFunction *function = &program->functions[index];
+    if (index == 0) {
+        fprintf(out, "main");
+    } else {
+        fprintf(out, "function %s", atom_name(atoms, function->name));
+    }
+    fprintf(out, " (params: %d, registers: %d, constants: %u, upvalues: %u, instructions: %zu)\n",
+            function->param_count, function->register_count, function->constant_count, function->upvalue_count,
+            function->code_count);
+    for (unsigned int u = 0; u < function->upvalue_count; u++) {
+        const IRUpvalue *upvalue = &function->upvalues[u];
+        fprintf(out, "  u%u  %s  ; %s %u\n", u, atom_name(atoms, upvalue->name),
+                upvalue->in_stack ? "registrador" : "upvalue", upvalue->index);
+    }
+
+    for (size_t pc = 0; pc < function->code_count; pc++) {
+        IRInstruction instruction = function->code[pc];
+        IROpcode op = IR_OP(instruction);
+        char line[16];
+        snprintf(line, sizeof(line), "[%u]", function->lines[pc]);
+        fprintf(out, "  %4zu  %-7s %-10s", pc, line, ir_opcode_name(op));
+        switch (op < IR_OPCODE_COUNT ? ir_opcodes[op].format : IR_FORMAT_AX) {
+            case IR_FORMAT_A:
+                fprintf(out, "r%d", IR_A(instruction));
+                break;
+            case IR_FORMAT_AB:
+                if (op == IR_CALL || op == IR_RETURN) {
+                    fprintf(out, "r%d %d", IR_A(instruction), IR_B(instruction));
+                } else if (op == IR_GETUPVAL || op == IR_SETUPVAL) {
+                    fprintf(out, "r%d u%d  ; %s", IR_A(instruction), IR_B(instruction),
+                            atom_name(atoms, function->upvalues[IR_B(instruction)].name));
+                } else {
+                    fprintf(out, "r%d r%d", IR_A(instruction), IR_B(instruction));
+                }
+                break;
+            case IR_FORMAT_ABC:
+                fprintf(out, "r%d r%d r%d", IR_A(instruction), IR_B(instruction), IR_C(instruction));
+                break;
+            case IR_FORMAT_AC:
+                fprintf(out, "r%d %d", IR_A(instruction), IR_C(instruction));
+                break;
+            case IR_FORMAT_ABX: {
+                unsigned int bx = IR_BX(instruction);
+                if (bx == IR_BX_EXTENDED && pc + 1 < function->code_count) {
+                    bx = IR_AX(function->code[pc + 1]);
+                }
+                if (op == IR_LOADK) {
+                    fprintf(out, "r%d k%u  ; ", IR_A(instruction), bx);
+                    ir_print_constant(program, atoms, &function->constants[bx], out);
+                } else if (op == IR_CLOSURE) {
+                    fprintf(out, "r%d f%u  ; function %s", IR_A(instruction), bx,
+                            atom_name(atoms, program->functions[bx].name));
+                } else {
+                    fprintf(out, "r%d g%u", IR_A(instruction), bx);
+                }
+                break;
+            }
+            case IR_FORMAT_SJ:
+                fprintf(out, "%d  ; -> %zu", IR_SJ(instruction), pc + 1 + (size_t)(ptrdiff_t)IR_SJ(instruction));
+                break;
+            case IR_FORMAT_AX:
+                fprintf(out, "%u", IR_AX(instruction));
+                break;
+        }
+        fputc('\n', out);
+    }
+}
+
+void ir_print(const IRProgram *program, const AtomTable *atoms, FILE *out) {
+    for (size_t i = 0; i < program->function_count; i++) {
+        if (i > 0) {
+            fputc('\n', out);
+        }
+        ir_print_function(program, atoms, (unsigned int)i, out);
+    }
+}
@@ -1,224 +1,576 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "lexer.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-
-const char *keywords[] = {
-    "if", "then", "else", "end", "function", "return", "while", "do", "local", NULL
-};
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-void lexer_init(LexerState *lexer, FILE *file) {
-    lexer->file = file;
-    lexer->current_char = fgetc(file);
+void lexer_init_buffer(LexerState *lexer, const char *source, size_t length) {
+    lexer->source = source;
+    lexer->cursor = source;
+    lexer->end = source + length;
     lexer->line = 1;
-    lexer->column = 1;
-    lexer->debug_mode = 0; 
-}
-
-void lexer_advance(LexerState *lexer) {
-    if (lexer->current_char == '\n') {
-        lexer->line++;
-        lexer->column = 0;
-    }
-    lexer->current_char = fgetc(lexer->file);
-    lexer->column++;
-}
-
-void lexer_skip_whitespace(LexerState *lexer) {
-    while (isspace(lexer->current_char)) {
-        lexer_advance(lexer);
-    }
-}
-
-void lexer_skip_comment(LexerState *lexer) {
-    if (lexer->current_char == '-') {
-        lexer_advance(lexer);
-        if (lexer->current_char == '-') {
-            lexer_advance(lexer);
-            if (lexer->current_char == '[') {
-                lexer_advance(lexer);
-                if (lexer->current_char == '[') {
-                    lexer_advance(lexer);
-                    while (lexer->current_char != EOF) {
-                        if (lexer->current_char == ']') {
-                            lexer_advance(lexer);
-                            if (lexer->current_char == ']') {
-                                lexer_advance(lexer);
-                                break;
-                            }
-                        } else {
-                            lexer_advance(lexer);
-                        }
-                    }
-                } else {
-                    while (lexer->current_char != '\n' && lexer->current_char != EOF) {
-                        lexer_advance(lexer);
-                    }
-                }
-            } else {
-                while (lexer->current_char != '\n' && lexer->current_char != EOF) {
-                    lexer_advance(lexer);
-                }
+    lexer->line_start = source;
+    lexer->scan = lexer_select_scanner();
+    lexer->atoms = NULL;
+    lexer->diagnostics = NULL;
+    lexer->debug_mode = 0;
+    lexer->owned_buffer = NULL;
+    lexer->mapped_size = 0;
+}
+
+// Lê todo o conteúdo de um fluxo para um buffer alocado
+static char *read_stream(FILE *file, size_t *length) {
+    size_t capacity = 4096;
+    size_t size = 0;
+    char *buffer = malloc(capacity);
+    if (!buffer) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    size_t n;
+    while ((n = fread(buffer + size, 1, capacity - size, file)) > 0) {
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+            if (!buffer) {
+                perror("Erro de alocação de memória");
+                exit(EXIT_FAILURE);
             }
-        } else {
-            ungetc(lexer->current_char, lexer->file);
-            lexer->current_char = '-';
-            lexer->column--;
         }
     }
+    *length = size;
+    return buffer;
 }
 
-int is_keyword(const char *str) {
-    for (int i = 0; keywords[i] != NULL; i++) {
-        if (strcmp(str, keywords[i]) == 0)
-            return 1;
-    }
-    return 0;
+void lexer_init(LexerState *lexer, FILE *file) {
+    size_t length;
+    char *buffer = read_stream(file, &length);
+    lexer_init_buffer(lexer, buffer, length);
+    lexer->owned_buffer = buffer;
 }
 
-Token lexer_get_next_token(LexerState *lexer) {
-    Token token;
-    token.line = lexer->line;
-    token.column = lexer->column;
-    if (lexer->debug_mode) {
-        printf("[Lexer] Iniciando lexer_get_next_token\n");
+int lexer_init_path(LexerState *lexer, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
     }
-    while (1) {
-        lexer_skip_whitespace(lexer);
-        lexer_skip_comment(lexer);
 
-        if (!isspace(lexer->current_char) && lexer->current_char != '-') {
-            break;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            lexer_init_buffer(lexer, data, (size_t)st.st_size);
+            lexer->mapped_size = (size_t)st.st_size;
+            return 0;
         }
     }
 
-    if (lexer->current_char == EOF) {
-        token.type = TOKEN_EOF;
-        strcpy(token.value, "EOF");
-        return token;
+    // Sem mmap (arquivo vazio, pipe, dispositivo): lê o conteúdo inteiro
+    FILE *file = fdopen(fd, "r");
+    if (!file) {
+        close(fd);
+        return -1;
+    }
+    lexer_init(lexer, file);
+    fclose(file);
+    return 0;
+}
+
+void lexer_free(LexerState *lexer) {
+    if (lexer->mapped_size > 0) {
+        munmap((void *)lexer->source, lexer->mapped_size);
     }
+    free(lexer->owned_buffer);
+    lexer->source = lexer->cursor = lexer->end = NULL;
+    lexer->owned_buffer = NULL;
+    lexer->mapped_size = 0;
+}
+
+/*
+ * Scanner dirigido por tabelas.
+ *
+ * Cada byte da entrada é mapeado para uma classe (char_class) e o autômato
+ * avança com transitions[estado][classe]. Estados a partir de F_EOF são
+ * finais: o token termina antes do byte que levou a eles, que não é
+ * consumido. Espaços e comentários voltam ao estado S_START, e o início do
+ * token é reposicionado a cada volta.
+ *
+ * Ao entrar em estados que tendem a consumir sequências longas (espaços,
+ * identificadores, corpo de strings e comentários), a varredura rápida de
+ * lexer->scan avança de uma vez até o primeiro byte que mudaria o estado.
+ */
+
+enum {
+    C_OTHER,     // Caractere inválido
+    C_SPACE,     // ' ', '\t', '\r', '\v', '\f'
+    C_NEWLINE,   // '\n'
+    C_ALPHA,     // Letras e '_'
+    C_DIGIT,
+    C_DOT,
+    C_QUOTE,
+    C_MINUS,
+    C_LBRACKET,
+    C_RBRACKET,
+    C_EQUALS,
+    C_RELOP,     // '~', '<', '>'
+    C_ARITH,     // '+', '*', '/', '%', '^'
+    C_PUNCT,     // '(', ')', ',', ';', ':'
+    C_EOF,       // Fim do buffer (não é um byte da entrada)
+    C_COUNT
+};
+
+enum {
+    S_START,
+    S_IDENT,
+    S_NUMBER,
+    S_STRING,
+    S_STRING_END,
+    S_OP1,            // Operador de um caractere já completo
+    S_OP_EQ,          // '=', '~', '<', '>' que aceitam um '=' em seguida
+    S_OP2,            // Operador de dois caracteres completo
+    S_MINUS,          // '-' que pode iniciar um comentário
+    S_DOT,            // '.' que pode formar '..'
+    S_COMMENT,        // Após '--'
+    S_COMMENT_BRACKET,// Após '--['
+    S_LINE_COMMENT,
+    S_LONG_COMMENT,   // Dentro de '--[[ ... ]]'
+    S_LONG_COMMENT_BRACKET, // Após um ']' dentro do comentário longo
+    S_PUNCT,
+    S_COUNT,
+
+    F_EOF = S_COUNT,
+    F_IDENT,
+    F_NUMBER,
+    F_STRING,
+    F_OPERATOR,
+    F_PUNCT,
+    F_ERR_CHAR,
+    F_ERR_STRING
+};
+
+static const unsigned char char_class[256] = {
+    [' '] = C_SPACE, ['\t'] = C_SPACE, ['\r'] = C_SPACE, ['\v'] = C_SPACE, ['\f'] = C_SPACE,
+    ['\n'] = C_NEWLINE,
+    ['a'] = C_ALPHA, ['b'] = C_ALPHA, ['c'] = C_ALPHA, ['d'] = C_ALPHA, ['e'] = C_ALPHA,
+    ['f'] = C_ALPHA, ['g'] = C_ALPHA, ['h'] = C_ALPHA, ['i'] = C_ALPHA, ['j'] = C_ALPHA,
+    ['k'] = C_ALPHA, ['l'] = C_ALPHA, ['m'] = C_ALPHA, ['n'] = C_ALPHA, ['o'] = C_ALPHA,
+    ['p'] = C_ALPHA, ['q'] = C_ALPHA, ['r'] = C_ALPHA, ['s'] = C_ALPHA, ['t'] = C_ALPHA,
+    ['u'] = C_ALPHA, ['v'] = C_ALPHA, ['w'] = C_ALPHA, ['x'] = C_ALPHA, ['y'] = C_ALPHA,
+    ['z'] = C_ALPHA,
+    ['A'] = C_ALPHA, ['B'] = C_ALPHA, ['C'] = C_ALPHA, ['D'] = C_ALPHA, ['E'] = C_ALPHA,
+    ['F'] = C_ALPHA, ['G'] = C_ALPHA, ['H'] = C_ALPHA, ['I'] = C_ALPHA, ['J'] = C_ALPHA,
+    ['K'] = C_ALPHA, ['L'] = C_ALPHA, ['M'] = C_ALPHA, ['N'] = C_ALPHA, ['O'] = C_ALPHA,
+    ['P'] = C_ALPHA, ['Q'] = C_ALPHA, ['R'] = C_ALPHA, ['S'] = C_ALPHA, ['T'] = C_ALPHA,
+    ['U'] = C_ALPHA, ['V'] = C_ALPHA, ['W'] = C_ALPHA, ['X'] = C_ALPHA, ['Y'] = C_ALPHA,
+    ['Z'] = C_ALPHA, ['_'] = C_ALPHA,
+    ['0'] = C_DIGIT, ['1'] = C_DIGIT, ['2'] = C_DIGIT, ['3'] = C_DIGIT, ['4'] = C_DIGIT,
+    ['5'] = C_DIGIT, ['6'] = C_DIGIT, ['7'] = C_DIGIT, ['8'] = C_DIGIT, ['9'] = C_DIGIT,
+    ['.'] = C_DOT,
+    ['"'] = C_QUOTE,
+    ['-'] = C_MINUS,
+    ['['] = C_LBRACKET,
+    [']'] = C_RBRACKET,
+    ['='] = C_EQUALS,
+    ['~'] = C_RELOP, ['<'] = C_RELOP, ['>'] = C_RELOP,
+    ['+'] = C_ARITH, ['*'] = C_ARITH, ['/'] = C_ARITH, ['%'] = C_ARITH, ['^'] = C_ARITH,
+    ['('] = C_PUNCT, [')'] = C_PUNCT, [','] = C_PUNCT, [';'] = C_PUNCT, [':'] = C_PUNCT,
+};
+
+#define ST(x) S_##x
+#define FI(x) F_##x
 
-    if (isalpha(lexer->current_char) || lexer->current_char == '_') {
-        int length = 0;
-        char buffer[MAX_TOKEN_LEN] = {0};
-        while (isalnum(lexer->current_char) || lexer->current_char == '_') {
-            if (length < MAX_TOKEN_LEN - 1) {
-                buffer[length++] = lexer->current_char;
+static const unsigned char transitions[S_COUNT][C_COUNT] = {
+    /*                          OTHER          SPACE              NEWLINE        ALPHA              DIGIT              DOT                QUOTE              MINUS              LBRACKET                RBRACKET                      EQUALS             RELOP              ARITH              PUNCT              EOF */
+    [S_START]             = { FI(ERR_CHAR),  ST(START),         ST(START),     ST(IDENT),         ST(NUMBER),        ST(DOT),           ST(STRING),        ST(MINUS),         FI(ERR_CHAR),           FI(ERR_CHAR),                 ST(OP_EQ),         ST(OP_EQ),         ST(OP1),           ST(PUNCT),         FI(EOF) },
+    [S_IDENT]             = { FI(IDENT),     FI(IDENT),         FI(IDENT),     ST(IDENT),         ST(IDENT),         FI(IDENT),         FI(IDENT),         FI(IDENT),         FI(IDENT),              FI(IDENT),                    FI(IDENT),         FI(IDENT),         FI(IDENT),         FI(IDENT),         FI(IDENT) },
+    [S_NUMBER]            = { FI(NUMBER),    FI(NUMBER),        FI(NUMBER),    FI(NUMBER),        ST(NUMBER),        ST(NUMBER),        FI(NUMBER),        FI(NUMBER),        FI(NUMBER),             FI(NUMBER),                   FI(NUMBER),        FI(NUMBER),        FI(NUMBER),        FI(NUMBER),        FI(NUMBER) },
+    [S_STRING]            = { ST(STRING),    ST(STRING),        ST(STRING),    ST(STRING),        ST(STRING),        ST(STRING),        ST(STRING_END),    ST(STRING),        ST(STRING),             ST(STRING),                   ST(STRING),        ST(STRING),        ST(STRING),        ST(STRING),        FI(ERR_STRING) },
+    [S_STRING_END]        = { FI(STRING),    FI(STRING),        FI(STRING),    FI(STRING),        FI(STRING),        FI(STRING),        FI(STRING),        FI(STRING),        FI(STRING),             FI(STRING),                   FI(STRING),        FI(STRING),        FI(STRING),        FI(STRING),        FI(STRING) },
+    [S_OP1]               = { FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),           FI(OPERATOR),                 FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR) },
+    [S_OP_EQ]             = { FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),           FI(OPERATOR),                 ST(OP2),           FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR) },
+    [S_OP2]               = { FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),           FI(OPERATOR),                 FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR) },
+    [S_MINUS]             = { FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      ST(COMMENT),       FI(OPERATOR),           FI(OPERATOR),                 FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR) },
+    [S_DOT]               = { FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),  FI(OPERATOR),      FI(OPERATOR),      ST(OP2),           FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),           FI(OPERATOR),                 FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR),      FI(OPERATOR) },
+    [S_COMMENT]           = { ST(LINE_COMMENT), ST(LINE_COMMENT), ST(START),   ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(COMMENT_BRACKET),    ST(LINE_COMMENT),             ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  FI(EOF) },
+    [S_COMMENT_BRACKET]   = { ST(LINE_COMMENT), ST(LINE_COMMENT), ST(START),   ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LONG_COMMENT),       ST(LINE_COMMENT),             ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  FI(EOF) },
+    [S_LINE_COMMENT]      = { ST(LINE_COMMENT), ST(LINE_COMMENT), ST(START),   ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),       ST(LINE_COMMENT),             ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  ST(LINE_COMMENT),  FI(EOF) },
+    [S_LONG_COMMENT]      = { ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT),    ST(LONG_COMMENT_BRACKET),     ST(LONG_COMMENT),  ST(LONG_COMMENT),  ST(LONG_COMMENT),  ST(LONG_COMMENT),  FI(EOF) },
+    [S_LONG_COMMENT_BRACKET] = { ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(LONG_COMMENT), ST(START),                    ST(LONG_COMMENT),  ST(LONG_COMMENT),  ST(LONG_COMMENT),  ST(LONG_COMMENT),  FI(EOF) },
+    [S_PUNCT]             = { FI(PUNCT),     FI(PUNCT),         FI(PUNCT),     FI(PUNCT),         FI(PUNCT),         FI(PUNCT),         FI(PUNCT),         FI(PUNCT),         FI(PUNCT),              FI(PUNCT),                    FI(PUNCT),         FI(PUNCT),         FI(PUNCT),         FI(PUNCT),         FI(PUNCT) },
+};
+
+#undef ST
+#undef FI
+
+// Varredura rápida que consome o restante de uma sequência no mesmo estado
+static const unsigned char state_scan[S_COUNT] = {
+    [S_START] = SCAN_SPACE,
+    [S_IDENT] = SCAN_IDENT,
+    [S_STRING] = SCAN_STRING,
+    [S_LINE_COMMENT] = SCAN_LINE,
+    [S_LONG_COMMENT] = SCAN_LONG_COMMENT,
+};
+
+// Tipo de token dos sinais de pontuação de um caractere
+static const unsigned char punct_token[256] = {
+    ['('] = TOKEN_PAREN_OPEN,
+    [')'] = TOKEN_PAREN_CLOSE,
+    [','] = TOKEN_COMMA,
+    [';'] = TOKEN_SEMICOLON,
+    [':'] = TOKEN_COLON,
+};
+
+/*
+ * Hash perfeito das palavras-chave: (tamanho + peso[primeira letra] +
+ * peso[última letra]) % 16 é distinto para cada palavra-chave, então basta
+ * uma comparação para confirmar o resultado. Ao incluir uma palavra-chave,
+ * os pesos precisam ser recalculados para manter a ausência de colisões.
+ */
+#define KEYWORD_HASH_SIZE 16
+#define KEYWORD_MAX_LEN 8
+
+static const unsigned char keyword_weight[256] = {
+    ['a'] = 13, ['d'] = 5, ['e'] = 12, ['f'] = 15, ['i'] = 9, ['l'] = 12,
+    ['n'] = 4, ['o'] = 15, ['r'] = 6, ['t'] = 7, ['w'] = 1,
+};
+
+static const struct {
+    const char *text;
+    unsigned char length;
+    Keyword keyword;
+} keyword_slots[KEYWORD_HASH_SIZE] = {
+    [0] = { "return", 6, KW_RETURN },
+    [1] = { "elseif", 6, KW_ELSEIF },
+    [2] = { "while", 5, KW_WHILE },
+    [3] = { "nil", 3, KW_NIL },
+    [4] = { "end", 3, KW_END },
+    [5] = { "and", 3, KW_AND },
+    [6] = { "do", 2, KW_DO },
+    [7] = { "or", 2, KW_OR },
+    [8] = { "for", 3, KW_FOR },
+    [10] = { "if", 2, KW_IF },
+    [11] = { "function", 8, KW_FUNCTION },
+    [12] = { "else", 4, KW_ELSE },
+    [13] = { "local", 5, KW_LOCAL },
+    [14] = { "not", 3, KW_NOT },
+    [15] = { "then", 4, KW_THEN },
+};
+
+static const char *const keyword_names[KW_COUNT] = {
+    [KW_AND] = "and", [KW_DO] = "do", [KW_ELSE] = "else", [KW_ELSEIF] = "elseif",
+    [KW_END] = "end", [KW_FOR] = "for", [KW_FUNCTION] = "function", [KW_IF] = "if",
+    [KW_LOCAL] = "local", [KW_NIL] = "nil", [KW_NOT] = "not", [KW_OR] = "or",
+    [KW_RETURN] = "return", [KW_THEN] = "then", [KW_WHILE] = "while",
+};
+
+Keyword keyword_lookup(const char *text, size_t length) {
+    if (length < 2 || length > KEYWORD_MAX_LEN) {
+        return KW_NONE;
+    }
+    const unsigned char *s = (const unsigned char *)text;
+    unsigned int h = (unsigned int)(length + keyword_weight[s[0]] + keyword_weight[s[length - 1]]) % KEYWORD_HASH_SIZE;
+    if (keyword_slots[h].length == length && memcmp(keyword_slots[h].text, text, length) == 0) {
+        return keyword_slots[h].keyword;
+    }
+    return KW_NONE;
+}
+
+const char *keyword_name(Keyword keyword) {
+    return keyword < KW_COUNT ? keyword_names[keyword] : "?";
+}
+
+/*
+ * Classificação dos operadores pelo lexema: operator_kind[tamanho - 1][primeiro
+ * byte]. Os operadores de dois caracteres são '..' e os terminados em '='.
+ * Um '.' ou '~' isolado fica como OP_NONE e é rejeitado pelo parser.
+ */
+static const unsigned char operator_kind[2][256] = {
+    {
+        ['+'] = OP_ADD, ['-'] = OP_SUB, ['*'] = OP_MUL, ['/'] = OP_DIV, ['%'] = OP_MOD,
+        ['^'] = OP_POW, ['<'] = OP_LT, ['>'] = OP_GT, ['='] = OP_ASSIGN,
+    },
+    {
+        ['='] = OP_EQ, ['~'] = OP_NE, ['<'] = OP_LE, ['>'] = OP_GE, ['.'] = OP_CONCAT,
+    },
+};
+
+static const char *const operator_names[OP_COUNT] = {
+    [OP_NONE] = "?", [OP_ADD] = "+", [OP_SUB] = "-", [OP_MUL] = "*", [OP_DIV] = "/",
+    [OP_MOD] = "%", [OP_EQ] = "==", [OP_NE] = "~=", [OP_LT] = "<", [OP_LE] = "<=",
+    [OP_GT] = ">", [OP_GE] = ">=", [OP_POW] = "^", [OP_CONCAT] = "..", [OP_AND] = "and",
+    [OP_OR] = "or", [OP_NOT] = "not", [OP_NEG] = "-", [OP_ASSIGN] = "=",
+};
+
+const char *op_name(OpKind op) {
+    return op < OP_COUNT ? operator_names[op] : "?";
+}
+
+// Converte o lexema de um número (dígitos e pontos) para double
+static double parse_number(const char *text, size_t length) {
+    char buffer[64];
+    if (length < sizeof(buffer)) {
+        memcpy(buffer, text, length);
+        buffer[length] = '\0';
+        return strtod(buffer, NULL);
+    }
+    double value = 0.0;
+    double scale = 0.0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '.') {
+            if (scale == 0.0) {
+                scale = 1.0;
             }
-            lexer_advance(lexer);
+            continue;
         }
-        buffer[length] = '\0';
+        value = value * 10.0 + (text[i] - '0');
+        scale *= 10.0;
+    }
+    return scale > 0.0 ? value / scale : value;
+}
 
-        token.type = is_keyword(buffer) ? TOKEN_KEYWORD : TOKEN_IDENTIFIER;
-        strcpy(token.value, buffer);
-        return token;
+Token lexer_get_next_token(LexerState *lexer) {
+    if (lexer->debug_mode) {
+        printf("[Lexer] Iniciando lexer_get_next_token\n");
     }
 
-    if (isdigit(lexer->current_char)) {
-        int length = 0;
-        char buffer[MAX_TOKEN_LEN] = {0};
-        while (isdigit(lexer->current_char) || lexer->current_char == '.') {
-            if (length < MAX_TOKEN_LEN - 1) {
-                buffer[length++] = lexer->current_char;
-            }
-            lexer_advance(lexer);
+    const unsigned char *p = (const unsigned char *)lexer->cursor;
+    const unsigned char *end = (const unsigned char *)lexer->end;
+    const unsigned char *start = p;
+    const char *line_start = lexer->line_start;
+    int line = lexer->line;
+    // Linha do início do token (strings podem atravessar linhas)
+    const char *token_line_start = line_start;
+    int token_line = line;
+    unsigned int state = S_START;
+    unsigned int next;
+
+    for (;;) {
+        unsigned int cls = p < end ? char_class[*p] : C_EOF;
+        next = transitions[state][cls];
+        if (next >= F_EOF) {
+            break;
         }
-        buffer[length] = '\0';
-        token.type = TOKEN_NUMBER;
-        strcpy(token.value, buffer);
-        return token;
-    }
-
-    if (lexer->current_char == '"') {
-        lexer_advance(lexer);
-        int length = 0;
-        char buffer[MAX_TOKEN_LEN] = {0};
-        while (lexer->current_char != '"' && lexer->current_char != EOF) {
-            if (length < MAX_TOKEN_LEN - 1) {
-                buffer[length++] = lexer->current_char;
-            }
-            lexer_advance(lexer);
+        int newline = cls == C_NEWLINE;
+        line += newline;
+        line_start = newline ? (const char *)p + 1 : line_start;
+        p++;
+        if (state_scan[next] != SCAN_NONE) {
+            p = (const unsigned char *)lexer->scan((const char *)p, lexer->end, (ScanKind)state_scan[next],
+                                                   &line, &line_start);
         }
-        if (lexer->current_char == '"') {
-            lexer_advance(lexer);
-        } else {
-            fprintf(stderr, "Erro léxico: String não terminada na linha %d, coluna %d\n", lexer->line, lexer->column);
-            exit(EXIT_FAILURE);
+        if (next == S_START) {
+            start = p;
+            token_line = line;
+            token_line_start = line_start;
         }
-        buffer[length] = '\0';
-        token.type = TOKEN_STRING;
-        strcpy(token.value, buffer);
-        return token;
-    }
-
-    switch (lexer->current_char) {
-        case '+': case '-': case '*': case '/': case '%':
-        case '=': case '~': case '<': case '>': {
-            int length = 0;
-            char buffer[3] = {0};
-            buffer[length++] = lexer->current_char;
-            lexer_advance(lexer);
-
-            if ((buffer[0] == '=' && lexer->current_char == '=') ||
-                (buffer[0] == '~' && lexer->current_char == '=') ||
-                (buffer[0] == '<' && lexer->current_char == '=') ||
-                (buffer[0] == '>' && lexer->current_char == '=')) {
-                buffer[length++] = lexer->current_char;
-                lexer_advance(lexer);
-            }
+        state = next;
+    }
+
+    lexer->cursor = (const char *)p;
+    lexer->line = line;
+    lexer->line_start = line_start;
+
+    Token token;
+    token.offset = (unsigned int)((const char *)start - lexer->source);
+    token.length = (unsigned int)(p - start);
+    token.line = token_line;
+    token.column = (int)((const char *)start - token_line_start) + 1;
+    token.value.number = 0.0;
 
-            buffer[length] = '\0';
+    switch (next) {
+        case F_EOF:
+            token.type = TOKEN_EOF;
+            token.offset = (unsigned int)((const char *)p - lexer->source);
+            token.length = 0;
+            break;
+        case F_IDENT:
+            token.value.keyword = keyword_lookup((const char *)start, token.length);
+            if (token.value.keyword != KW_NONE) {
+                token.type = TOKEN_KEYWORD;
+            } else {
+                token.type = TOKEN_IDENTIFIER;
+                token.value.atom = lexer->atoms ? atom_intern(lexer->atoms, (const char *)start, token.length) : ATOM_NONE;
+            }
+            break;
+        case F_NUMBER:
+            token.type = TOKEN_NUMBER;
+            token.value.number = parse_number((const char *)start, token.length);
+            break;
+        case F_STRING:
+            // O lexema de uma string não inclui as aspas
+            token.type = TOKEN_STRING;
+            token.offset++;
+            token.length -= 2;
+            token.value.atom = lexer->atoms ? atom_intern(lexer->atoms, (const char *)start + 1, token.length) : ATOM_NONE;
+            break;
+        case F_OPERATOR:
             token.type = TOKEN_OPERATOR;
-            strcpy(token.value, buffer);
-            return token;
-        }
-        case '(':
-            token.type = TOKEN_PAREN_OPEN;
-            strcpy(token.value, "(");
-            lexer_advance(lexer);
-            return token;
-        case ')':
-            token.type = TOKEN_PAREN_CLOSE;
-            strcpy(token.value, ")");
-            lexer_advance(lexer);
-            return token;
-        case ',':
-            token.type = TOKEN_COMMA;
-            strcpy(token.value, ",");
-            lexer_advance(lexer);
-            return token;
-        case ';':
-            token.type = TOKEN_SEMICOLON;
-            strcpy(token.value, ";");
-            lexer_advance(lexer);
-            return token;
-        case ':':
-            token.type = TOKEN_COLON;
-            strcpy(token.value, ":");
-            lexer_advance(lexer);
-            return token;
+            token.value.op = (OpKind)operator_kind[token.length - 1][*start];
+            break;
+        case F_PUNCT:
+            token.type = (TokenType)punct_token[*start];
+            break;
+        case F_ERR_STRING:
+            token.type = TOKEN_UNKNOWN;
+            if (lexer->diagnostics) {
+                int column = (int)((const char *)p - line_start) + 1;
+                diagnostics_report(lexer->diagnostics, line, column,
+                                   "Erro léxico: String não terminada na linha %d, coluna %d", line, column);
+            }
+            break;
         default:
-            fprintf(stderr, "Erro léxico: Caractere desconhecido '%c' na linha %d, coluna %d\n",
-                    lexer->current_char, lexer->line, lexer->column);
-            exit(EXIT_FAILURE);
+            // O caractere inválido é consumido para que a leitura prossiga
+            token.type = TOKEN_UNKNOWN;
+            token.offset = (unsigned int)((const char *)p - lexer->source);
+            token.length = 1;
+            token.line = line;
+            token.column = (int)((const char *)p - line_start) + 1;
+            lexer->cursor = (const char *)p + 1;
+            if (lexer->diagnostics) {
+                diagnostics_report(lexer->diagnostics, token.line, token.column,
+                                   "Erro léxico: Caractere desconhecido '%c' na linha %d, coluna %d",
+                                   *p, token.line, token.column);
+            }
+            break;
     }
+    return token;
 }
 
-void token_print(Token token) {
+// Move os tokens mantidos para o começo dos vetores
+static void token_stream_compact(TokenStream *stream) {
+    size_t head = stream->head, n = stream->count;
+    memmove(stream->kinds, stream->kinds + head, n * sizeof(*stream->kinds));
+    memmove(stream->offsets, stream->offsets + head, n * sizeof(*stream->offsets));
+    memmove(stream->lengths, stream->lengths + head, n * sizeof(*stream->lengths));
+    memmove(stream->lines, stream->lines + head, n * sizeof(*stream->lines));
+    memmove(stream->columns, stream->columns + head, n * sizeof(*stream->columns));
+    memmove(stream->values, stream->values + head, n * sizeof(*stream->values));
+    stream->head = 0;
+}
+
+/*
+ * Garante espaço para mais um token em todos os vetores da sequência. Se ao
+ * menos metade dos vetores é de tokens descartados, os mantidos voltam ao
+ * começo em vez de os vetores crescerem; como cada compactação move no
+ * máximo tantos tokens quantos foram descartados desde a anterior, o custo
+ * por token é constante.
+ */
+static void token_stream_reserve(TokenStream *stream) {
+    if (stream->head + stream->count < stream->capacity) {
+        return;
+    }
+    if (stream->head > 0 && stream->count <= stream->capacity / 2) {
+        token_stream_compact(stream);
+        return;
+    }
+    size_t capacity = stream->capacity ? stream->capacity * 2 : 1024;
+    stream->kinds = realloc(stream->kinds, capacity * sizeof(*stream->kinds));
+    stream->offsets = realloc(stream->offsets, capacity * sizeof(*stream->offsets));
+    stream->lengths = realloc(stream->lengths, capacity * sizeof(*stream->lengths));
+    stream->lines = realloc(stream->lines, capacity * sizeof(*stream->lines));
+    stream->columns = realloc(stream->columns, capacity * sizeof(*stream->columns));
+    stream->values = realloc(stream->values, capacity * sizeof(*stream->values));
+    if (!stream->kinds || !stream->offsets || !stream->lengths ||
+        !stream->lines || !stream->columns || !stream->values) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    stream->capacity = capacity;
+}
+
+size_t lexer_tokenize_some(LexerState *lexer, TokenStream *stream, size_t max) {
+    size_t produced = 0;
+    if (stream->count > 0 && stream->kinds[stream->head + stream->count - 1] == TOKEN_EOF) {
+        return 0;
+    }
+    Token token;
+    do {
+        token = lexer_get_next_token(lexer);
+        token_stream_reserve(stream);
+        size_t i = stream->head + stream->count++;
+        stream->kinds[i] = (unsigned char)token.type;
+        stream->offsets[i] = token.offset;
+        stream->lengths[i] = token.length;
+        stream->lines[i] = token.line;
+        stream->columns[i] = token.column;
+        stream->values[i] = token.value;
+        produced++;
+    } while (token.type != TOKEN_EOF && produced < max);
+    return produced;
+}
+
+void lexer_tokenize(LexerState *lexer, TokenStream *stream) {
+    lexer_tokenize_some(lexer, stream, SIZE_MAX);
+}
+
+Token token_stream_get(const TokenStream *stream, size_t index) {
+    if (index >= stream->count) {
+        index = stream->count - 1;
+    }
+    index += stream->head;
+    Token token;
+    token.type = (TokenType)stream->kinds[index];
+    token.offset = stream->offsets[index];
+    token.length = stream->lengths[index];
+    token.line = stream->lines[index];
+    token.column = stream->columns[index];
+    token.value = stream->values[index];
+    return token;
+}
+
+void token_stream_discard(TokenStream *stream, size_t n) {
+    if (n > stream->count) {
+        n = stream->count;
+    }
+    stream->head += n;
+    stream->count -= n;
+}
+
+void token_stream_free(TokenStream *stream) {
+    free(stream->kinds);
+    free(stream->offsets);
+    free(stream->lengths);
+    free(stream->lines);
+    free(stream->columns);
+    free(stream->values);
+    memset(stream, 0, sizeof(*stream));
+}
+
+const char *token_text(const LexerState *lexer, Token token) {
+    return lexer->source + token.offset;
+}
+
+int token_equals(const LexerState *lexer, Token token, const char *text) {
+    return strlen(text) == token.length && memcmp(lexer->source + token.offset, text, token.length) == 0;
+}
+
+void token_print(const LexerState *lexer, Token token) {
     const char *token_type_names[] = {
         "TOKEN_EOF",
-        "TOKEN_IDENTIFIER",
         "TOKEN_NUMBER",
+        "TOKEN_IDENTIFIER",
         "TOKEN_STRING",
         "TOKEN_OPERATOR",
         "TOKEN_KEYWORD",
         "TOKEN_PAREN_OPEN",
         "TOKEN_PAREN_CLOSE",
-        "TOKEN_COMMA",
+        "TOKEN_BRACE_OPEN",
+        "TOKEN_BRACE_CLOSE",
         "TOKEN_SEMICOLON",
+        "TOKEN_COLON",
+        "TOKEN_COMMA",
+        "TOKEN_UNKNOWN",
     };
 
-    printf("Token Type: %s, Value: '%s', Line: %d, Column: %d\n",
-           token_type_names[token.type], token.value, token.line, token.column);
+    printf("Token Type: %s, Value: '%.*s', Line: %d, Column: %d\n",
+           token_type_names[token.type], (int)token.length, token_text(lexer, token),
+           token.line, token.column);
 }
@@ -0,0 +1,256 @@
+#include "lexer_simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define LEXER_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LEXER_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// Registra as quebras de linha presentes em mask (bit i = byte p[i])
+#define COUNT_NEWLINES(mask, p, line, line_start)                              \
+    do {                                                                       \
+        if (mask) {                                                            \
+            *(line) += __builtin_popcount(mask);                               \
+            *(line_start) = (p) + (31 - __builtin_clz(mask)) + 1;              \
+        }                                                                      \
+    } while (0)
+
+/* ---------------------------------------------------------------------------
+ * Implementação escalar (usada também para os bytes finais das versões SIMD)
+ * ------------------------------------------------------------------------ */
+
+ALWAYS_INLINE int scan_stops(ScanKind kind, unsigned char c) {
+    switch (kind) {
+        case SCAN_SPACE:
+            return !(c == ' ' || (c >= '\t' && c <= '\r'));
+        case SCAN_IDENT:
+            return !((c | 0x20) >= 'a' && (c | 0x20) <= 'z') && !(c >= '0' && c <= '9') && c != '_';
+        case SCAN_STRING:
+            return c == '"';
+        case SCAN_LINE:
+            return c == '\n';
+        case SCAN_LONG_COMMENT:
+            return c == ']';
+        default:
+            return 1;
+    }
+}
+
+ALWAYS_INLINE const char *scalar_scan_kind(const char *p, const char *end, ScanKind kind,
+                                           int *line, const char **line_start) {
+    while (p < end && !scan_stops(kind, (unsigned char)*p)) {
+        if (*p == '\n') {
+            (*line)++;
+            *line_start = p + 1;
+        }
+        p++;
+    }
+    return p;
+}
+
+static const char *scalar_scan(const char *p, const char *end, ScanKind kind,
+                               int *line, const char **line_start) {
+    switch (kind) {
+        case SCAN_SPACE: return scalar_scan_kind(p, end, SCAN_SPACE, line, line_start);
+        case SCAN_IDENT: return scalar_scan_kind(p, end, SCAN_IDENT, line, line_start);
+        case SCAN_STRING: return scalar_scan_kind(p, end, SCAN_STRING, line, line_start);
+        case SCAN_LINE: return scalar_scan_kind(p, end, SCAN_LINE, line, line_start);
+        case SCAN_LONG_COMMENT: return scalar_scan_kind(p, end, SCAN_LONG_COMMENT, line, line_start);
+        default: return p;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * SSE2: 16 bytes por iteração
+ * ------------------------------------------------------------------------ */
+
+#ifdef LEXER_HAVE_SSE2
+
+// Bytes de x no intervalo [lo, hi], usando comparação com sinal deslocada
+ALWAYS_INLINE __m128i sse2_in_range(__m128i x, int lo, int hi) {
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x80 + hi - lo + 1)));
+}
+
+ALWAYS_INLINE unsigned sse2_stop_mask(__m128i block, ScanKind kind) {
+    switch (kind) {
+        case SCAN_SPACE: {
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                         sse2_in_range(block, '\t', '\r'));
+            return ~(unsigned)_mm_movemask_epi8(space) & 0xFFFFu;
+        }
+        case SCAN_IDENT: {
+            __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+            __m128i ident = _mm_or_si128(sse2_in_range(lower, 'a', 'z'),
+                                         _mm_or_si128(sse2_in_range(block, '0', '9'),
+                                                      _mm_cmpeq_epi8(block, _mm_set1_epi8('_'))));
+            return ~(unsigned)_mm_movemask_epi8(ident) & 0xFFFFu;
+        }
+        case SCAN_STRING:
+            return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+        case SCAN_LINE:
+            return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')));
+        case SCAN_LONG_COMMENT:
+            return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(']')));
+        default:
+            return 1;
+    }
+}
+
+ALWAYS_INLINE const char *sse2_scan_kind(const char *p, const char *end, ScanKind kind,
+                                         int *line, const char **line_start) {
+    // Identificadores e comentários de linha nunca atravessam um '\n'
+    int count_lines = kind == SCAN_SPACE || kind == SCAN_STRING || kind == SCAN_LONG_COMMENT;
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    // Sequências curtas (um espaço entre tokens) não compensam um bloco inteiro
+    if (p < end && scan_stops(kind, (unsigned char)*p)) {
+        return p;
+    }
+
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        unsigned stop = sse2_stop_mask(block, kind);
+        unsigned lines = count_lines ? (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)) : 0;
+        if (stop) {
+            unsigned n = (unsigned)__builtin_ctz(stop);
+            lines &= (1u << n) - 1;
+            COUNT_NEWLINES(lines, p, line, line_start);
+            return p + n;
+        }
+        COUNT_NEWLINES(lines, p, line, line_start);
+        p += 16;
+    }
+    return scalar_scan_kind(p, end, kind, line, line_start);
+}
+
+static const char *sse2_scan(const char *p, const char *end, ScanKind kind,
+                             int *line, const char **line_start) {
+    switch (kind) {
+        case SCAN_SPACE: return sse2_scan_kind(p, end, SCAN_SPACE, line, line_start);
+        case SCAN_IDENT: return sse2_scan_kind(p, end, SCAN_IDENT, line, line_start);
+        case SCAN_STRING: return sse2_scan_kind(p, end, SCAN_STRING, line, line_start);
+        case SCAN_LINE: return sse2_scan_kind(p, end, SCAN_LINE, line, line_start);
+        case SCAN_LONG_COMMENT: return sse2_scan_kind(p, end, SCAN_LONG_COMMENT, line, line_start);
+        default: return p;
+    }
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------
+ * AVX2: 32 bytes por iteração, habilitado apenas se a CPU suportar
+ * ------------------------------------------------------------------------ */
+
+#ifdef LEXER_HAVE_AVX2
+
+#define AVX2_INLINE static inline __attribute__((always_inline, target("avx2")))
+
+AVX2_INLINE __m256i avx2_in_range(__m256i x, int lo, int hi) {
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + hi - lo + 1)), shifted);
+}
+
+AVX2_INLINE unsigned avx2_stop_mask(__m256i block, ScanKind kind) {
+    switch (kind) {
+        case SCAN_SPACE: {
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+                                            avx2_in_range(block, '\t', '\r'));
+            return ~(unsigned)_mm256_movemask_epi8(space);
+        }
+        case SCAN_IDENT: {
+            __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+            __m256i ident = _mm256_or_si256(avx2_in_range(lower, 'a', 'z'),
+                                            _mm256_or_si256(avx2_in_range(block, '0', '9'),
+                                                            _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_'))));
+            return ~(unsigned)_mm256_movemask_epi8(ident);
+        }
+        case SCAN_STRING:
+            return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+        case SCAN_LINE:
+            return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')));
+        case SCAN_LONG_COMMENT:
+            return (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(']')));
+        default:
+            return 1;
+    }
+}
+
+AVX2_INLINE const char *avx2_scan_kind(const char *p, const char *end, ScanKind kind,
+                                       int *line, const char **line_start) {
+    int count_lines = kind == SCAN_SPACE || kind == SCAN_STRING || kind == SCAN_LONG_COMMENT;
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    if (p < end && scan_stops(kind, (unsigned char)*p)) {
+        return p;
+    }
+
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        unsigned stop = avx2_stop_mask(block, kind);
+        unsigned lines = count_lines ? (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)) : 0;
+        if (stop) {
+            unsigned n = (unsigned)__builtin_ctz(stop);
+            lines &= (1u << n) - 1;
+            COUNT_NEWLINES(lines, p, line, line_start);
+            return p + n;
+        }
+        COUNT_NEWLINES(lines, p, line, line_start);
+        p += 32;
+    }
+    return scalar_scan_kind(p, end, kind, line, line_start);
+}
+
+__attribute__((target("avx2")))
+static const char *avx2_scan(const char *p, const char *end, ScanKind kind,
+                             int *line, const char **line_start) {
+    switch (kind) {
+        case SCAN_SPACE: return avx2_scan_kind(p, end, SCAN_SPACE, line, line_start);
+        case SCAN_IDENT: return avx2_scan_kind(p, end, SCAN_IDENT, line, line_start);
+        case SCAN_STRING: return avx2_scan_kind(p, end, SCAN_STRING, line, line_start);
+        case SCAN_LINE: return avx2_scan_kind(p, end, SCAN_LINE, line, line_start);
+        case SCAN_LONG_COMMENT: return avx2_scan_kind(p, end, SCAN_LONG_COMMENT, line, line_start);
+        default: return p;
+    }
+}
+
+#endif
+
+ScanFunction lexer_select_scanner(void) {
+    const char *forced = getenv("LUNATICO_SIMD");
+    if (forced && strcmp(forced, "scalar") == 0) {
+        return scalar_scan;
+    }
+#ifdef LEXER_HAVE_AVX2
+    if ((!forced || strcmp(forced, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        return avx2_scan;
+    }
+#endif
+#ifdef LEXER_HAVE_SSE2
+    return sse2_scan;
+#else
+    return scalar_scan;
+#endif
+}
+
+const char *lexer_scanner_name(ScanFunction scan) {
+#ifdef LEXER_HAVE_AVX2
+    if (scan == avx2_scan) {
+        return "avx2";
+    }
+#endif
+#ifdef LEXER_HAVE_SSE2
+    if (scan == sse2_scan) {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
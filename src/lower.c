@@ -0,0 +1,622 @@
+#include "lower.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A tradução é um visitante da AST (ver ast_walk). Cada subexpressão deixa
+ * em values o registrador com o seu valor: o de uma variável local é o
+ * próprio registrador da variável; os demais valores ocupam o próximo
+ * temporário livre. Como os temporários são liberados na ordem inversa da
+ * reserva, os argumentos de uma chamada ficam em registradores seguidos,
+ * logo após o registrador da função chamada.
+ */
+
+static void *lower_reserve_items(void *items, size_t count, size_t *capacity, size_t item_size) {
+    if (count < *capacity) {
+        return items;
+    }
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    items = realloc(items, new_capacity * item_size);
+    if (!items) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return items;
+}
+
+// Operação de cada operador binário; swap troca os operandos (a > b é b < a)
+typedef struct {
+    IROpcode opcode;
+    int swap;
+} LowerBinaryRule;
+
+static const LowerBinaryRule lower_binary_rules[OP_COUNT] = {
+    [OP_ADD] = {IR_ADD, 0},
+    [OP_SUB] = {IR_SUB, 0},
+    [OP_MUL] = {IR_MUL, 0},
+    [OP_DIV] = {IR_DIV, 0},
+    [OP_MOD] = {IR_MOD, 0},
+    [OP_POW] = {IR_POW, 0},
+    [OP_CONCAT] = {IR_CONCAT, 0},
+    [OP_EQ] = {IR_EQ, 0},
+    [OP_NE] = {IR_NE, 0},
+    [OP_LT] = {IR_LT, 0},
+    [OP_LE] = {IR_LE, 0},
+    [OP_GT] = {IR_LT, 1},
+    [OP_GE] = {IR_LE, 1},
+};
+
+static LowerFunction *lower_current(LowerState *lower) {
+    return &lower->functions[lower->function_count - 1];
+}
+
+// A função pode mudar de lugar quando outra é acrescentada ao programa
+static IRFunction *lower_code(LowerState *lower) {
+    return &lower->program->functions[lower_current(lower)->function];
+}
+
+static void lower_emit(LowerState *lower, IRInstruction instruction) {
+    ir_emit(lower_code(lower), instruction, lower->line);
+}
+
+static void lower_track_registers(LowerState *lower, int count) {
+    if (count > IR_MAX_REGISTERS) {
+        diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                          "Erro: função com mais de %d registradores (variáveis locais e temporários) na linha %u.",
+                          IR_MAX_REGISTERS, lower->line);
+    }
+    IRFunction *code = lower_code(lower);
+    if (count > code->register_count) {
+        code->register_count = count;
+    }
+}
+
+// Reserva o próximo temporário
+static int lower_reserve(LowerState *lower) {
+    LowerFunction *function = lower_current(lower);
+    int reg = function->free_reg++;
+    lower_track_registers(lower, function->free_reg);
+    return reg;
+}
+
+// Libera reg (e os temporários acima dele) se for um temporário
+static void lower_release(LowerState *lower, int reg) {
+    LowerFunction *function = lower_current(lower);
+    if (reg >= function->locals && reg < function->free_reg) {
+        function->free_reg = reg;
+    }
+}
+
+static void lower_push(LowerState *lower, int reg) {
+    lower->values = lower_reserve_items(lower->values, lower->value_count, &lower->value_capacity, sizeof(int));
+    lower->values[lower->value_count++] = reg;
+}
+
+static int lower_pop(LowerState *lower) {
+    return lower->values[--lower->value_count];
+}
+
+static void lower_load_constant(LowerState *lower, int reg, IRConstant constant) {
+    unsigned int index = ir_constant(lower_code(lower), constant);
+    if (index > IR_AX_MAX) {
+        diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                          "Erro: constantes demais em uma função na linha %u.", lower->line);
+    }
+    ir_emit_abx(lower_code(lower), IR_LOADK, reg, index, lower->line);
+}
+
+// Emite um salto a ser corrigido por lower_patch e devolve a sua posição
+static size_t lower_jump(LowerState *lower) {
+    return ir_emit(lower_code(lower), IR_MAKE_SJ(IR_JMP, 0), lower->line);
+}
+
+// Faz o salto em at continuar em target
+static void lower_patch(LowerState *lower, size_t at, size_t target) {
+    long offset = (long)target - (long)(at + 1);
+    if (offset < IR_SJ_MIN || offset > IR_SJ_MAX) {
+        diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                          "Erro: salto longo demais na linha %u.", lower->line);
+    }
+    lower_code(lower)->code[at] = IR_MAKE_SJ(IR_JMP, offset);
+}
+
+static size_t lower_here(LowerState *lower) {
+    return lower_code(lower)->code_count;
+}
+
+/* ---------------------------------------------------------------------------
+ * Ambiente: o mesmo esquema de registro de desfazer da análise semântica
+ * ------------------------------------------------------------------------ */
+
+static void lower_bind(LowerState *lower, Atom name, LowerBinding *binding) {
+    lower->undo = lower_reserve_items(lower->undo, lower->undo_count, &lower->undo_capacity, sizeof(LowerEntry));
+    lower->undo[lower->undo_count].name = name;
+    lower->undo[lower->undo_count].binding = binding;
+    lower->undo[lower->undo_count].shadowed = symbol_table_insert(&lower->bindings, name, binding);
+    lower->undo_count++;
+}
+
+static LowerBinding *lower_new_binding(LowerState *lower, LowerBindingKind kind, unsigned int index) {
+    LowerBinding *binding = arena_alloc(&lower->arena, sizeof(LowerBinding));
+    binding->kind = kind;
+    binding->depth = (int)lower->function_count - 1;
+    binding->index = index;
+    binding->captured = 0;
+    return binding;
+}
+
+static size_t lower_scope_enter(LowerState *lower) {
+    return lower->undo_count;
+}
+
+static void lower_scope_leave(LowerState *lower, size_t mark) {
+    while (lower->undo_count > mark) {
+        LowerEntry *entry = &lower->undo[--lower->undo_count];
+        if (entry->shadowed) {
+            symbol_table_insert(&lower->bindings, entry->name, entry->shadowed);
+        } else {
+            symbol_table_remove(&lower->bindings, entry->name);
+        }
+    }
+}
+
+static LowerBinding *lower_resolve(LowerState *lower, Atom name) {
+    LowerBinding *binding = symbol_table_lookup_local(&lower->bindings, name);
+    if (!binding) {
+        diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                          "Erro: variável '%s' não declarada na linha %u.", atom_name(lower->atoms, name), lower->line);
+    }
+    return binding;
+}
+
+// Variável local de uma função envolvente (acessada por upvalue)
+static int lower_is_upvalue(LowerState *lower, const LowerBinding *binding) {
+    return binding->kind == LOWER_LOCAL && binding->depth != (int)lower->function_count - 1;
+}
+
+/*
+ * Índice do upvalue da função atual para a variável local binding de uma
+ * função envolvente. Cada função entre as duas repassa a variável por um
+ * upvalue próprio.
+ */
+static int lower_upvalue(LowerState *lower, Atom name, LowerBinding *binding) {
+    binding->captured = 1;
+    IRUpvalue upvalue = {name, 1, (unsigned char)binding->index};
+    unsigned int index = 0;
+    for (size_t depth = (size_t)binding->depth + 1; depth < lower->function_count; depth++) {
+        index = ir_upvalue(&lower->program->functions[lower->functions[depth].function], upvalue);
+        if (index >= IR_MAX_UPVALUES) {
+            diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                              "Erro: função com mais de %d upvalues na linha %u.", IR_MAX_UPVALUES, lower->line);
+        }
+        upvalue.in_stack = 0;
+        upvalue.index = (unsigned char)index;
+    }
+    return (int)index;
+}
+
+// Copia o valor de uma variável para reg
+static void lower_load_variable(LowerState *lower, Atom name, int reg) {
+    LowerBinding *binding = lower_resolve(lower, name);
+    switch (binding->kind) {
+        case LOWER_LOCAL:
+            if (lower_is_upvalue(lower, binding)) {
+                lower_emit(lower, IR_MAKE_ABC(IR_GETUPVAL, reg, lower_upvalue(lower, name, binding), 0));
+            } else {
+                lower_emit(lower, IR_MAKE_ABC(IR_MOVE, reg, (int)binding->index, 0));
+            }
+            break;
+        case LOWER_GLOBAL:
+            ir_emit_abx(lower_code(lower), IR_GETGLOBAL, reg, binding->index, lower->line);
+            break;
+        case LOWER_FUNCTION: {
+            IRConstant constant = {.kind = IR_CONST_FUNCTION, .function = binding->index};
+            lower_load_constant(lower, reg, constant);
+            break;
+        }
+    }
+}
+
+// Registrador com o valor de uma variável (sem cópia para variáveis locais)
+static int lower_variable(LowerState *lower, Atom name) {
+    LowerBinding *binding = lower_resolve(lower, name);
+    if (binding->kind == LOWER_LOCAL && !lower_is_upvalue(lower, binding)) {
+        return (int)binding->index;
+    }
+    int reg = lower_reserve(lower);
+    lower_load_variable(lower, name, reg);
+    return reg;
+}
+
+static void lower_store(LowerState *lower, Atom name, int value) {
+    LowerBinding *binding = lower_resolve(lower, name);
+    switch (binding->kind) {
+        case LOWER_LOCAL:
+            if (lower_is_upvalue(lower, binding)) {
+                lower_emit(lower, IR_MAKE_ABC(IR_SETUPVAL, value, lower_upvalue(lower, name, binding), 0));
+            } else if ((int)binding->index != value) {
+                lower_emit(lower, IR_MAKE_ABC(IR_MOVE, (int)binding->index, value, 0));
+            }
+            break;
+        case LOWER_GLOBAL:
+            ir_emit_abx(lower_code(lower), IR_SETGLOBAL, value, binding->index, lower->line);
+            break;
+        case LOWER_FUNCTION:
+            diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                              "Erro: atribuição à função '%s' dentro do próprio corpo na linha %u não é suportada.",
+                              atom_name(lower->atoms, name), lower->line);
+    }
+}
+
+/*
+ * Declara name com o valor em value: uma nova global no nível superior ou
+ * o próximo registrador local dentro de uma função.
+ */
+static void lower_declare(LowerState *lower, Atom name, int value) {
+    LowerBinding *binding;
+    if (lower->function_count == 1) {
+        if (lower->program->global_count > IR_AX_MAX) {
+            diagnostics_fatal(lower->diagnostics, (int)lower->line, 0,
+                              "Erro: variáveis globais demais na linha %u.", lower->line);
+        }
+        binding = lower_new_binding(lower, LOWER_GLOBAL, lower->program->global_count++);
+        ir_emit_abx(lower_code(lower), IR_SETGLOBAL, value, binding->index, lower->line);
+        lower_release(lower, value);
+    } else {
+        LowerFunction *function = lower_current(lower);
+        int reg = function->locals;
+        if (value != reg) {
+            lower_emit(lower, IR_MAKE_ABC(IR_MOVE, reg, value, 0));
+        }
+        function->locals++;
+        function->free_reg = function->locals;
+        lower_track_registers(lower, function->locals);
+        binding = lower_new_binding(lower, LOWER_LOCAL, (unsigned int)reg);
+    }
+    lower_bind(lower, name, binding);
+}
+
+/* ---------------------------------------------------------------------------
+ * Visitante
+ * ------------------------------------------------------------------------ */
+
+// Desvia para um salto a corrigir quando R[reg] tiver a verdade oposta a truth
+static size_t lower_branch_unless(LowerState *lower, int reg, int truth) {
+    lower_emit(lower, IR_MAKE_ABC(IR_TEST, reg, 0, !truth));
+    return lower_jump(lower);
+}
+
+// Trabalho feito entre dois filhos de parent, antes do filho index
+static void lower_before_child(LowerState *lower, ASTNode *parent, int index) {
+    LowerFrame *frame = &lower->frames[lower->frame_count - 1];
+    switch (parent->type) {
+        case AST_IF_STATEMENT:
+            if (index == 1) {
+                int condition = lower_pop(lower);
+                lower_release(lower, condition);
+                frame->jump = lower_branch_unless(lower, condition, 1);
+            } else if (index == 2) {
+                size_t skip_else = lower_jump(lower);
+                lower_patch(lower, frame->jump, lower_here(lower));
+                frame->jump = skip_else;
+            }
+            break;
+        case AST_WHILE_STATEMENT:
+            if (index == 1) {
+                int condition = lower_pop(lower);
+                lower_release(lower, condition);
+                frame->jump = lower_branch_unless(lower, condition, 1);
+            }
+            break;
+        case AST_BINARY_OP: {
+            OpKind op = parent->binary_op.op;
+            if (index == 1 && (op == OP_AND || op == OP_OR)) {
+                // O resultado fica no registrador do operando esquerdo, que
+                // precisa ser um temporário; o direito só é avaliado se necessário
+                int left = lower->values[lower->value_count - 1];
+                if (left < lower_current(lower)->locals) {
+                    int reg = lower_reserve(lower);
+                    lower_emit(lower, IR_MAKE_ABC(IR_MOVE, reg, left, 0));
+                    lower->values[lower->value_count - 1] = left = reg;
+                }
+                frame->jump = lower_branch_unless(lower, left, op == OP_AND);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void lower_function_enter(LowerState *lower, ASTNode *node, LowerFrame *frame) {
+    int n = node->function_declaration.param_count;
+    int nested = lower->function_count > 1;
+    frame->function = ir_add_function(lower->program, node->function_declaration.name, n, node->line);
+
+    // Uma função aninhada é uma variável local da envolvente, já visível no
+    // próprio corpo: a recursão e as funções irmãs a capturam como upvalue
+    if (nested) {
+        LowerFunction *enclosing = lower_current(lower);
+        frame->reg = enclosing->locals++;
+        enclosing->free_reg = enclosing->locals;
+        lower_track_registers(lower, enclosing->locals);
+        lower_bind(lower, node->function_declaration.name,
+                   lower_new_binding(lower, LOWER_LOCAL, (unsigned int)frame->reg));
+    }
+    frame->scope = lower_scope_enter(lower);
+
+    lower->functions = lower_reserve_items(lower->functions, lower->function_count, &lower->function_capacity,
+                                           sizeof(LowerFunction));
+    LowerFunction *function = &lower->functions[lower->function_count++];
+    function->function = frame->function;
+    function->locals = n;
+    function->free_reg = n;
+    lower_track_registers(lower, n);
+
+    // Parâmetros e o próprio nome, na mesma ordem da análise semântica
+    for (int i = 0; i < n; i++) {
+        lower_bind(lower, node->function_declaration.parameters[i]->function_parameter.name,
+                   lower_new_binding(lower, LOWER_LOCAL, (unsigned int)i));
+    }
+    if (!nested) {
+        lower_bind(lower, node->function_declaration.name, lower_new_binding(lower, LOWER_FUNCTION, frame->function));
+    }
+}
+
+static void lower_function_leave(LowerState *lower, ASTNode *node, LowerFrame *frame) {
+    // Uma função sem return no fim devolve nil
+    lower_emit(lower, IR_MAKE_ABC(IR_RETURN, 0, 0, 0));
+    lower->function_count--;
+    lower_scope_leave(lower, frame->scope);
+
+    // Só funções aninhadas capturam variáveis; as demais são constantes
+    IRConstant constant = {.kind = IR_CONST_FUNCTION, .function = frame->function};
+    if (lower->function_count == 1) {
+        int reg = lower_reserve(lower);
+        lower_load_constant(lower, reg, constant);
+        lower_declare(lower, node->function_declaration.name, reg);
+    } else if (lower->program->functions[frame->function].upvalue_count > 0) {
+        ir_emit_abx(lower_code(lower), IR_CLOSURE, frame->reg, frame->function, lower->line);
+    } else {
+        lower_load_constant(lower, frame->reg, constant);
+    }
+}
+
+// Alguma variável local declarada desde mark foi capturada
+static int lower_scope_captured(LowerState *lower, size_t mark) {
+    for (size_t i = mark; i < lower->undo_count; i++) {
+        if (lower->undo[i].binding->captured) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static ASTVisitResult lower_enter(void *context, const ASTVisit *visit) {
+    LowerState *lower = context;
+    ASTNode *node = visit->node;
+    if (visit->parent) {
+        lower->line = visit->parent->line;
+        lower_before_child(lower, visit->parent, visit->index);
+    }
+    lower->line = node->line;
+
+    lower->frames = lower_reserve_items(lower->frames, lower->frame_count, &lower->frame_capacity, sizeof(LowerFrame));
+    LowerFrame *frame = &lower->frames[lower->frame_count++];
+    memset(frame, 0, sizeof(*frame));
+
+    switch (node->type) {
+        case AST_BLOCK:
+            frame->scope = lower_scope_enter(lower);
+            frame->locals = lower_current(lower)->locals;
+            break;
+        case AST_WHILE_STATEMENT:
+            frame->loop = lower_here(lower);
+            break;
+        case AST_FUNCTION_DECLARATION:
+            lower_function_enter(lower, node, frame);
+            break;
+        case AST_FUNCTION_CALL:
+            frame->reg = lower_reserve(lower);
+            lower_load_variable(lower, node->function_call.function_name, frame->reg);
+            break;
+        default:
+            break;
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+static ASTVisitResult lower_leave(void *context, const ASTVisit *visit) {
+    LowerState *lower = context;
+    ASTNode *node = visit->node;
+    LowerFrame *frame = &lower->frames[--lower->frame_count];
+    lower->line = node->line;
+
+    switch (node->type) {
+        case AST_NUMBER: {
+            int reg = lower_reserve(lower);
+            IRConstant constant = {.kind = IR_CONST_NUMBER, .number = node->number.value};
+            lower_load_constant(lower, reg, constant);
+            lower_push(lower, reg);
+            break;
+        }
+        case AST_STRING: {
+            int reg = lower_reserve(lower);
+            IRConstant constant = {.kind = IR_CONST_STRING, .string = node->string.value};
+            lower_load_constant(lower, reg, constant);
+            lower_push(lower, reg);
+            break;
+        }
+        case AST_VARIABLE:
+            // O destino de uma atribuição é tratado pela própria atribuição
+            if (visit->parent && visit->parent->type == AST_ASSIGNMENT && visit->index == 0) {
+                break;
+            }
+            lower_push(lower, lower_variable(lower, node->variable.name));
+            break;
+        case AST_BINARY_OP: {
+            OpKind op = node->binary_op.op;
+            int right = lower_pop(lower);
+            int left = lower_pop(lower);
+            lower_release(lower, right);
+            if (op == OP_AND || op == OP_OR) {
+                if (right != left) {
+                    lower_emit(lower, IR_MAKE_ABC(IR_MOVE, left, right, 0));
+                }
+                lower_patch(lower, frame->jump, lower_here(lower));
+                lower_push(lower, left);
+                break;
+            }
+            lower_release(lower, left);
+            const LowerBinaryRule *rule = &lower_binary_rules[op];
+            IROpcode opcode = rule->opcode;
+            // Comparações entre números dispensam o teste de tipo em tempo de execução
+            if (node->binary_op.left->data_type == TYPE_NUMBER) {
+                opcode = opcode == IR_LT ? IR_LTN : opcode == IR_LE ? IR_LEN : opcode;
+            }
+            int reg = lower_reserve(lower);
+            if (rule->swap) {
+                lower_emit(lower, IR_MAKE_ABC(opcode, reg, right, left));
+            } else {
+                lower_emit(lower, IR_MAKE_ABC(opcode, reg, left, right));
+            }
+            lower_push(lower, reg);
+            break;
+        }
+        case AST_UNARY_OP: {
+            int operand = lower_pop(lower);
+            lower_release(lower, operand);
+            int reg = lower_reserve(lower);
+            lower_emit(lower, IR_MAKE_ABC(node->unary_op.op == OP_NOT ? IR_NOT : IR_NEG, reg, operand, 0));
+            lower_push(lower, reg);
+            break;
+        }
+        case AST_ASSIGNMENT: {
+            int value = lower_pop(lower);
+            lower_store(lower, node->assignment.variable->variable.name, value);
+            lower_release(lower, value);
+            break;
+        }
+        case AST_VARIABLE_DECLARATION: {
+            int value;
+            if (node->variable_declaration.expression) {
+                value = lower_pop(lower);
+            } else {
+                value = lower_reserve(lower);
+                lower_emit(lower, IR_MAKE_ABC(IR_LOADNIL, value, 0, 0));
+            }
+            lower_declare(lower, node->variable_declaration.name, value);
+            break;
+        }
+        case AST_IF_STATEMENT:
+            lower_patch(lower, frame->jump, lower_here(lower));
+            break;
+        case AST_WHILE_STATEMENT: {
+            size_t back = lower_jump(lower);
+            lower_patch(lower, back, frame->loop);
+            lower_patch(lower, frame->jump, lower_here(lower));
+            break;
+        }
+        case AST_BLOCK: {
+            LowerFunction *function = lower_current(lower);
+            if (lower_scope_captured(lower, frame->scope)) {
+                lower_emit(lower, IR_MAKE_ABC(IR_CLOSE, frame->locals, 0, 0));
+            }
+            lower_scope_leave(lower, frame->scope);
+            function->locals = frame->locals;
+            function->free_reg = frame->locals;
+            break;
+        }
+        case AST_RETURN_STATEMENT:
+            if (node->return_statement.expression) {
+                int value = lower_pop(lower);
+                lower_emit(lower, IR_MAKE_ABC(IR_RETURN, value, 1, 0));
+                lower_release(lower, value);
+            } else {
+                lower_emit(lower, IR_MAKE_ABC(IR_RETURN, 0, 0, 0));
+            }
+            break;
+        case AST_FUNCTION_CALL: {
+            int count = node->function_call.arg_count;
+            lower->value_count -= (size_t)count;
+            lower_emit(lower, IR_MAKE_ABC(IR_CALL, frame->reg, count, 0));
+            lower_current(lower)->free_reg = frame->reg + 1;
+            // Em um comando, o resultado da chamada é descartado
+            if (!visit->parent || visit->parent->type == AST_BLOCK) {
+                lower_release(lower, frame->reg);
+            } else {
+                lower_push(lower, frame->reg);
+            }
+            break;
+        }
+        case AST_FUNCTION_DECLARATION:
+            lower_function_leave(lower, node, frame);
+            break;
+        default:
+            break;
+    }
+
+    // Argumentos precisam ocupar os registradores seguintes ao da função
+    if (visit->parent && visit->parent->type == AST_FUNCTION_CALL) {
+        int value = lower->values[lower->value_count - 1];
+        if (value < lower_current(lower)->locals) {
+            int reg = lower_reserve(lower);
+            lower_emit(lower, IR_MAKE_ABC(IR_MOVE, reg, value, 0));
+            lower->values[lower->value_count - 1] = reg;
+        }
+    }
+    return AST_VISIT_CONTINUE;
+}
+
+void lower_begin(LowerState *lower, IRProgram *program, const AtomTable *atoms, Diagnostics *diagnostics) {
+    memset(lower, 0, sizeof(*lower));
+    lower->program = program;
+    symbol_table_init(&lower->bindings, NULL);
+    arena_init(&lower->arena, 0);
+    lower->atoms = atoms;
+    lower->diagnostics = diagnostics;
+
+    // O nível superior é a função 0 do programa
+    lower->functions = lower_reserve_items(NULL, 0, &lower->function_capacity, sizeof(LowerFunction));
+    lower->functions[0].function = 0;
+    lower->functions[0].locals = 0;
+    lower->functions[0].free_reg = 0;
+    lower->function_count = 1;
+}
+
+void lower_declare_builtin(LowerState *lower, Atom name) {
+    lower_bind(lower, name, lower_new_binding(lower, LOWER_GLOBAL, lower->program->global_count++));
+}
+
+void lower_statement(LowerState *lower, ASTNode *statement) {
+    // Um erro anterior pode ter deixado as pilhas pela metade
+    lower->walk.count = 0;
+    lower->frame_count = 0;
+    lower->value_count = 0;
+    lower->function_count = 1;
+    lower->functions[0].free_reg = lower->functions[0].locals;
+
+    ASTVisitor visitor = {lower_enter, lower_leave, lower};
+    ast_walk(statement, &visitor, 1, &lower->walk);
+}
+
+void lower_finish(LowerState *lower) {
+    if (lower->finished) {
+        return;
+    }
+    lower->function_count = 1;
+    lower_emit(lower, IR_MAKE_ABC(IR_RETURN, 0, 0, 0));
+    lower->finished = 1;
+}
+
+void lower_free(LowerState *lower) {
+    symbol_table_free(&lower->bindings);
+    arena_release(&lower->arena);
+    ast_walk_stack_free(&lower->walk);
+    free(lower->undo);
+    free(lower->functions);
+    free(lower->frames);
+    free(lower->values);
+    memset(lower, 0, sizeof(*lower));
+}
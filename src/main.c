@@ -1,58 +1,393 @@
-#include "semantic.h"
-#include "lexer.h"
-#include "parser.h"
+#define _POSIX_C_SOURCE 200809L
+
+#include "compiler.h"
+#include "thread_pool.h"
+#include "vm.h"
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static double elapsed_seconds(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Mede a vazão do lexer convertendo toda a entrada em tokens
+static void bench_lexer(LexerState *lexer) {
+    TokenStream stream = {0};
+    struct timespec start, end;
+    size_t bytes = (size_t)(lexer->end - lexer->source);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lexer_tokenize(lexer, &stream);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsed_seconds(&start, &end);
+    printf("Varredura: %s, tokens: %zu, bytes: %zu, tempo: %.3f ms, vazão: %.1f MB/s\n",
+           lexer_scanner_name(lexer->scan), stream.count, bytes, seconds * 1e3, seconds > 0 ? (double)bytes / seconds / 1e6 : 0.0);
+    token_stream_free(&stream);
+}
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} FileList;
+
+static void file_list_add(FileList *list, const char *path, size_t length) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char *));
+        if (!list->paths) {
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
+        }
+    }
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, path, length);
+    copy[length] = '\0';
+    list->paths[list->count++] = copy;
+}
+
+// Lê um arquivo de resposta (@lista): um caminho por linha, linhas vazias ignoradas
+static int file_list_read(FileList *list, const char *list_path) {
+    FILE *file = fopen(list_path, "r");
+    if (!file) {
+        return -1;
+    }
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ((length = getline(&line, &size, file)) != -1) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' ||
+                              line[length - 1] == ' ' || line[length - 1] == '\t')) {
+            length--;
+        }
+        if (length > 0) {
+            file_list_add(list, line, (size_t)length);
+        }
+    }
+    free(line);
+    fclose(file);
+    return 0;
+}
+
+static void file_list_free(FileList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+}
+
+// Resultado da verificação de um arquivo no modo com vários arquivos
+typedef struct {
+    CompilerStatus status;
+    size_t statements;
+    double seconds;
+    Diagnostics diagnostics;
+} FileResult;
+
+typedef struct {
+    char **paths;
+    FileResult *results;
+    int debug_mode;
+} CheckJob;
+
+// Tarefa do pool: verifica um arquivo com um contexto próprio
+static void check_file(void *context, size_t index) {
+    CheckJob *job = context;
+    FileResult *result = &job->results[index];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    CompilerContext compiler;
+    compiler_init(&compiler);
+    compiler.debug_mode = job->debug_mode;
+
+    result->statements = 0;
+    CompilerStatus status = compiler_open_path(&compiler, job->paths[index]);
+    if (status == COMPILER_OK) {
+        ASTNode *statement;
+        while ((status = compiler_next_statement(&compiler, &statement)) == COMPILER_OK) {
+            result->statements++;
+        }
+    }
+    result->status = status == COMPILER_ERROR ? COMPILER_ERROR : COMPILER_OK;
+
+    // Os diagnósticos passam a pertencer ao resultado
+    result->diagnostics = compiler.diagnostics;
+    diagnostics_init(&compiler.diagnostics);
+    compiler_free(&compiler);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result->seconds = elapsed_seconds(&start, &end);
+}
+
+// Verifica vários arquivos em paralelo e relata na ordem dos argumentos
+static int check_files(FileList *files, size_t threads, int debug_mode) {
+    FileResult *results = calloc(files->count, sizeof(FileResult));
+    if (!results) {
+        perror("Erro de alocação de memória");
+        return 1;
+    }
+    CheckJob job = { files->paths, results, debug_mode };
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t used = thread_pool_run(threads, files->count, check_file, &job);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    size_t failed = 0;
+    size_t statements = 0;
+    double busy = 0.0;
+    for (size_t i = 0; i < files->count; i++) {
+        FileResult *result = &results[i];
+        busy += result->seconds;
+        statements += result->statements;
+        if (result->status == COMPILER_OK) {
+            printf("%s: ok (%zu comandos, %.3f ms)\n", files->paths[i], result->statements, result->seconds * 1e3);
+        } else {
+            failed++;
+            printf("%s: erro\n", files->paths[i]);
+            fflush(stdout);
+            for (size_t d = 0; d < result->diagnostics.count; d++) {
+                fprintf(stderr, "%s: %s\n", files->paths[i], result->diagnostics.items[d].message);
+            }
+        }
+        diagnostics_free(&result->diagnostics);
+    }
+
+    double wall = elapsed_seconds(&start, &end);
+    printf("Arquivos: %zu (ok: %zu, com erro: %zu), comandos: %zu, threads: %zu\n",
+           files->count, files->count - failed, failed, statements, used);
+    printf("Tempo: %.3f ms (soma por arquivo: %.3f ms, %.1f arquivos/s)\n",
+           wall * 1e3, busy * 1e3, wall > 0 ? (double)files->count / wall : 0.0);
+
+    free(results);
+    return failed > 0 ? 1 : 0;
+}
+
+// Pico de memória residente do processo, em KB
+static long max_resident_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+/*
+ * Verifica o mesmo arquivo várias vezes, cada uma com um contexto novo, e
+ * relata o pico de memória residente após a primeira e após a última
+ * verificação. Com toda a memória liberada ao fim de cada compilação, os
+ * dois valores devem ser praticamente iguais.
+ */
+static int repeat_check(const char *filename, long repeats, int debug_mode) {
+    size_t statements = 0;
+    size_t type_bytes = 0;
+    long first_kb = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long i = 0; i < repeats; i++) {
+        CompilerContext context;
+        compiler_init(&context);
+        context.debug_mode = debug_mode;
+
+        statements = 0;
+        CompilerStatus status = compiler_open_path(&context, filename);
+        if (status == COMPILER_OK) {
+            ASTNode *statement;
+            while ((status = compiler_next_statement(&context, &statement)) == COMPILER_OK) {
+                statements++;
+            }
+        }
+        if (status == COMPILER_ERROR) {
+            fflush(stdout);
+            diagnostics_print(&context.diagnostics, stderr);
+            compiler_free(&context);
+            return 1;
+        }
+        type_bytes = context.semantic.types.bytes_allocated;
+        compiler_free(&context);
+
+        if (i == 0) {
+            first_kb = max_resident_kb();
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = elapsed_seconds(&start, &end);
+    printf("Repetições: %ld, comandos por verificação: %zu, tempo médio: %.3f ms\n",
+           repeats, statements, seconds * 1e3 / (double)repeats);
+    printf("Memória: arena de tipos %zu bytes por verificação, pico residente %ld KB após a primeira e %ld KB após a última\n",
+           type_bytes, first_kb, max_resident_kb());
+    return 0;
+}
+
+static void usage(const char *program) {
+    printf("Uso: %s [run] [--debug] [--lexer] [--lexer-bench] [--emit-ir] [-j N] [--repeat N] <arquivo.lua | @lista>...\n", program);
+}
 
 int main(int argc, char *argv[]) {
     int debug_mode = 0;
     int test_lexer = 0;
-    char *filename = NULL;
+    int lexer_bench = 0;
+    int emit_ir = 0;
+    int run = 0;
+    size_t threads = 0;
+    long repeats = 0;
+    FileList files = {0};
+
+    // "lunatico run arquivo.lua" executa o programa em vez de imprimir a AST
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "run") == 0) {
+        run = 1;
+        first = 2;
+    }
 
-    for (int i = 1; i < argc; i++) {
+    for (int i = first; i < argc; i++) {
         if (strcmp(argv[i], "--debug") == 0) {
             debug_mode = 1;
         } else if (strcmp(argv[i], "--lexer") == 0) {
             test_lexer = 1;
+        } else if (strcmp(argv[i], "--lexer-bench") == 0) {
+            lexer_bench = 1;
+        } else if (strcmp(argv[i], "--emit-ir") == 0) {
+            emit_ir = 1;
+        } else if (strncmp(argv[i], "-j", 2) == 0) {
+            const char *count = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            char *end;
+            long n = strtol(count, &end, 10);
+            if (*count == '\0' || *end != '\0' || n < 1) {
+                fprintf(stderr, "Número de threads inválido: '%s'\n", count);
+                file_list_free(&files);
+                return 1;
+            }
+            threads = (size_t)n;
+        } else if (strcmp(argv[i], "--repeat") == 0) {
+            const char *count = i + 1 < argc ? argv[++i] : "";
+            char *end;
+            repeats = strtol(count, &end, 10);
+            if (*count == '\0' || *end != '\0' || repeats < 1) {
+                fprintf(stderr, "Número de repetições inválido: '%s'\n", count);
+                file_list_free(&files);
+                return 1;
+            }
+        } else if (argv[i][0] == '@') {
+            if (file_list_read(&files, argv[i] + 1) != 0) {
+                perror("Erro ao abrir a lista de arquivos");
+                file_list_free(&files);
+                return 1;
+            }
         } else {
-            filename = argv[i];
+            file_list_add(&files, argv[i], strlen(argv[i]));
         }
     }
 
-    if (filename == NULL) {
-        printf("Uso: %s [--debug] [--lexer] <arquivo.lua>\n", argv[0]);
+    if (files.count == 0) {
+        usage(argv[0]);
+        file_list_free(&files);
         return 1;
     }
 
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Erro ao abrir o arquivo");
-        return 1;
+    if (files.count > 1) {
+        if (test_lexer || lexer_bench || emit_ir || run || repeats) {
+            fprintf(stderr, "run, --lexer, --lexer-bench, --emit-ir e --repeat aceitam um único arquivo\n");
+            file_list_free(&files);
+            return 1;
+        }
+        int status = check_files(&files, threads, debug_mode);
+        file_list_free(&files);
+        return status;
     }
 
-    LexerState lexer;
-    lexer_init(&lexer, file);
-    lexer.debug_mode = debug_mode;
+    const char *filename = files.paths[0];
+    int exit_code = 0;
 
-    if (test_lexer) {
-        Token token;
-        do {
-            token = lexer_get_next_token(&lexer);
-            token_print(token);
-        } while (token.type != TOKEN_EOF);
-    } else {
-        ParserState parser;
-        parser_init(&parser, &lexer);
-        parser.debug_mode = debug_mode;
+    if (test_lexer || lexer_bench) {
+        LexerState lexer;
+        if (strcmp(filename, "-") == 0) {
+            lexer_init(&lexer, stdin);
+        } else if (lexer_init_path(&lexer, filename) != 0) {
+            perror("Erro ao abrir o arquivo");
+            file_list_free(&files);
+            return 1;
+        }
+        lexer.debug_mode = debug_mode;
+
+        AtomTable atoms;
+        atom_table_init(&atoms);
+        lexer.atoms = &atoms;
 
-        ASTNode *ast = parse(&parser);
+        if (lexer_bench) {
+            bench_lexer(&lexer);
+        } else {
+            Token token;
+            do {
+                token = lexer_get_next_token(&lexer);
+                token_print(&lexer, token);
+            } while (token.type != TOKEN_EOF);
+        }
+
+        atom_table_free(&atoms);
+        lexer_free(&lexer);
+        file_list_free(&files);
+        return 0;
+    }
+
+    if (repeats) {
+        exit_code = repeat_check(filename, repeats, debug_mode);
+        file_list_free(&files);
+        return exit_code;
+    }
 
-        print_ast(ast, 0);
-        semantic_check(ast);
-        print_ast(ast, 0);
+    CompilerContext context;
+    compiler_init(&context);
+    context.debug_mode = debug_mode;
+    context.lowering = emit_ir || run;
+
+    CompilerStatus status = compiler_open_path(&context, filename);
+    if (status == COMPILER_OK && run) {
+        // O programa só executa depois de inteiramente verificado e traduzido
+        ASTNode *statement;
+        while ((status = compiler_next_statement(&context, &statement)) == COMPILER_OK) {
+        }
+        if (status == COMPILER_DONE) {
+            VM vm;
+            vm_init(&vm, &context.program, &context.atoms, &context.diagnostics);
+            if (vm_run(&vm) != 0) {
+                status = COMPILER_ERROR;
+            }
+            vm_free(&vm);
+        }
+    } else if (status == COMPILER_OK && emit_ir) {
+        ASTNode *statement;
+        while ((status = compiler_next_statement(&context, &statement)) == COMPILER_OK) {
+        }
+        if (status == COMPILER_DONE) {
+            ir_print(&context.program, &context.atoms, stdout);
+        }
+    } else if (status == COMPILER_OK) {
+        // Cada comando de nível superior é verificado, impresso e descartado
+        // antes do próximo, então a memória não cresce com o arquivo
+        printf("Block\n");
+        ASTNode *statement;
+        while ((status = compiler_next_statement(&context, &statement)) == COMPILER_OK) {
+            print_ast(statement, &context.atoms, 1);
+        }
+    }
+
+    if (status == COMPILER_ERROR) {
+        fflush(stdout);
+        diagnostics_print(&context.diagnostics, stderr);
+        exit_code = 1;
+    } else if (!emit_ir && !run) {
         printf("Análise semântica concluída com sucesso.\n");
-        free_ast(ast);
     }
 
-    fclose(file);
-    return 0;
+    compiler_free(&context);
+    file_list_free(&files);
+    return exit_code;
 }
@@ -2,15 +2,210 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+
+// Argumentos para imprimir o lexema de um token com "%.*s"
+#define TOKEN_ARGS(parser, token) (int)(token).length, token_text((parser)->lexer, (token))
+
+/*
+ * Poder de ligação dos operadores binários, no estilo de Lua: um operador
+ * continua a expressão à esquerda enquanto left > limite, e o operando da
+ * direita é lido com limite right. right < left torna o operador associativo
+ * à direita ('..' e '^'). Operadores com left zero não são binários.
+ */
+static const struct
+{
+    unsigned char left;
+    unsigned char right;
+} binary_power[OP_COUNT] = {
+    [OP_OR] = {1, 1},
+    [OP_AND] = {2, 2},
+    [OP_EQ] = {3, 3}, [OP_NE] = {3, 3},
+    [OP_LT] = {3, 3}, [OP_LE] = {3, 3},
+    [OP_GT] = {3, 3}, [OP_GE] = {3, 3},
+    [OP_CONCAT] = {9, 8},
+    [OP_ADD] = {10, 10}, [OP_SUB] = {10, 10},
+    [OP_MUL] = {11, 11}, [OP_DIV] = {11, 11}, [OP_MOD] = {11, 11},
+    [OP_POW] = {14, 13},
+};
+
+// Limite com que o operando de um operador unário é lido ('^' liga mais forte)
+#define UNARY_POWER 12
+
+// Operadores escritos como palavras-chave
+static const unsigned char keyword_op[KW_COUNT] = {
+    [KW_AND] = OP_AND,
+    [KW_OR] = OP_OR,
+    [KW_NOT] = OP_NOT,
+};
+
+// Verifica se o token é o operador indicado
+static int token_is_op(Token token, OpKind op)
+{
+    return token.type == TOKEN_OPERATOR && token.value.op == op;
+}
 
-// Inicializa o estado do parser
-void parser_init(ParserState *parser, LexerState *lexer)
+// Operador representado pelo token (símbolo ou palavra-chave), ou OP_NONE
+static OpKind token_op(Token token)
+{
+    if (token.type == TOKEN_OPERATOR)
+    {
+        return token.value.op;
+    }
+    if (token.type == TOKEN_KEYWORD)
+    {
+        return (OpKind)keyword_op[token.value.keyword];
+    }
+    return OP_NONE;
+}
+
+// Verifica se o token atual é a palavra-chave indicada
+static int parser_at_keyword(ParserState *parser, Keyword keyword)
+{
+    return parser->current_token.type == TOKEN_KEYWORD &&
+           parser->current_token.value.keyword == keyword;
+}
+
+// Tokens pedidos ao lexer de cada vez quando a janela se esgota
+#define PARSER_TOKEN_BATCH 4096
+
+// Retorna o token de índice index da janela, lendo mais tokens se preciso
+static Token parser_token_at(ParserState *parser, size_t index)
+{
+    while (index >= parser->tokens.count &&
+           lexer_tokenize_some(parser->lexer, &parser->tokens, PARSER_TOKEN_BATCH) > 0)
+    {
+    }
+    return token_stream_get(&parser->tokens, index);
+}
+
+/*
+ * Registra um erro de sintaxe no token atual e abandona a análise (ver
+ * diagnostics_fatal). Se o token atual já é um erro léxico, a mensagem do
+ * lexer basta.
+ */
+__attribute__((noreturn)) static void parser_error(ParserState *parser, const char *format, ...)
+{
+    Diagnostics *diagnostics = parser->lexer->diagnostics;
+    Token token = parser->current_token;
+    if (token.type != TOKEN_UNKNOWN)
+    {
+        va_list args;
+        va_start(args, format);
+        diagnostics_vreport(diagnostics, token.line, token.column, format, args);
+        va_end(args);
+    }
+    diagnostics_abort(diagnostics);
+}
+
+// Inicializa o estado do parser; os tokens são lidos sob demanda
+void parser_init(ParserState *parser, LexerState *lexer, Arena *arena)
 {
     parser->lexer = lexer;
-    parser->current_token = lexer_get_next_token(lexer);
+    parser->arena = arena;
+    memset(&parser->tokens, 0, sizeof(parser->tokens));
+    parser->position = 0;
+    parser->current_token = parser_token_at(parser, 0);
+    parser->scratch = NULL;
+    parser->scratch_count = 0;
+    parser->scratch_capacity = 0;
+    parser->operators = NULL;
+    parser->operator_count = 0;
+    parser->operator_capacity = 0;
+    parser->depth = 0;
     parser->debug_mode = 0; // Modo de depuração desativado por padrão
 }
 
+// Libera a sequência de tokens do parser
+void parser_free(ParserState *parser)
+{
+    token_stream_free(&parser->tokens);
+    free(parser->scratch);
+    parser->scratch = NULL;
+    parser->scratch_count = parser->scratch_capacity = 0;
+    free(parser->operators);
+    parser->operators = NULL;
+    parser->operator_count = parser->operator_capacity = 0;
+}
+
+/*
+ * Listas de filhos são montadas na pilha de rascunho do parser: cada
+ * construção anota a altura da pilha ao abrir, empilha os filhos à medida que
+ * são lidos (listas aninhadas empilham por cima) e, ao fechar, copia os seus
+ * filhos uma única vez, com o tamanho exato, para a arena.
+ */
+static void parser_scratch_push(ParserState *parser, ASTNode *node)
+{
+    if (parser->scratch_count == parser->scratch_capacity)
+    {
+        size_t capacity = parser->scratch_capacity ? parser->scratch_capacity * 2 : 64;
+        ASTNode **scratch = realloc(parser->scratch, capacity * sizeof(ASTNode *));
+        if (!scratch)
+        {
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
+        }
+        parser->scratch = scratch;
+        parser->scratch_capacity = capacity;
+    }
+    parser->scratch[parser->scratch_count++] = node;
+}
+
+// Desempilha os filhos acima de mark, copiando-os para a arena
+static ASTNode **parser_scratch_pop(ParserState *parser, size_t mark, int *count)
+{
+    size_t n = parser->scratch_count - mark;
+    ASTNode **children = NULL;
+    if (n > 0)
+    {
+        children = arena_alloc(parser->arena, n * sizeof(ASTNode *));
+        memcpy(children, parser->scratch + mark, n * sizeof(ASTNode *));
+    }
+    parser->scratch_count = mark;
+    *count = (int)n;
+    return children;
+}
+
+static void parser_operator_push(ParserState *parser, OpKind op, ASTNode *left, Token start, int limit)
+{
+    if (parser->operator_count == parser->operator_capacity)
+    {
+        size_t capacity = parser->operator_capacity ? parser->operator_capacity * 2 : 32;
+        ParserOperator *operators = realloc(parser->operators, capacity * sizeof(ParserOperator));
+        if (!operators)
+        {
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
+        }
+        parser->operators = operators;
+        parser->operator_capacity = capacity;
+    }
+    ParserOperator *entry = &parser->operators[parser->operator_count++];
+    entry->left = left;
+    entry->start = start;
+    entry->op = op;
+    entry->limit = limit;
+}
+
+/*
+ * Blocos e subexpressões ainda são lidos recursivamente; limitar o
+ * aninhamento mantém a pilha nativa usada pelo parser limitada mesmo para
+ * entradas patológicas.
+ */
+static void parser_enter(ParserState *parser)
+{
+    if (++parser->depth > PARSER_MAX_DEPTH)
+    {
+        parser_error(parser, "Erro de sintaxe: aninhamento excessivo (mais de %d níveis) na linha %d, coluna %d",
+                PARSER_MAX_DEPTH, parser->current_token.line, parser->current_token.column);
+    }
+}
+
+static void parser_leave(ParserState *parser)
+{
+    parser->depth--;
+}
+
 // Consome o token atual se corresponder ao tipo esperado
 void parser_eat(ParserState *parser, TokenType type)
 {
@@ -18,47 +213,71 @@ void parser_eat(ParserState *parser, TokenType type)
     {
         if (parser->debug_mode)
         {
-            printf("[Parser] Consumindo token: Tipo=%d, Valor='%s', Linha=%d, Coluna=%d\n",
-                   parser->current_token.type, parser->current_token.value,
+            printf("[Parser] Consumindo token: Tipo=%d, Valor='%.*s', Linha=%d, Coluna=%d\n",
+                   parser->current_token.type, TOKEN_ARGS(parser, parser->current_token),
                    parser->current_token.line, parser->current_token.column);
         }
-        parser->current_token = lexer_get_next_token(parser->lexer);
+        parser->position++;
+        parser->current_token = parser_token_at(parser, parser->position);
     }
     else
     {
-        fprintf(stderr, "Erro de sintaxe: Esperado token %d, encontrado %d ('%s') na linha %d, coluna %d\n",
-                type, parser->current_token.type, parser->current_token.value,
+        parser_error(parser, "Erro de sintaxe: Esperado token %d, encontrado %d ('%.*s') na linha %d, coluna %d",
+                type, parser->current_token.type, TOKEN_ARGS(parser, parser->current_token),
                 parser->current_token.line, parser->current_token.column);
-        exit(EXIT_FAILURE);
     }
 }
 
-// Olha o próximo token sem consumi-lo
-Token parser_peek_next_token(ParserState *parser)
+// Consome o token atual se for a palavra-chave esperada
+static void parser_eat_keyword(ParserState *parser, Keyword keyword)
 {
-    LexerState *lexer = parser->lexer;
+    if (!parser_at_keyword(parser, keyword))
+    {
+        parser_error(parser, "Erro de sintaxe: Esperado '%s', encontrado '%.*s' na linha %d, coluna %d",
+                keyword_name(keyword), TOKEN_ARGS(parser, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    }
+    parser_eat(parser, TOKEN_KEYWORD);
+}
 
-    // Salva o estado atual do lexer
-    long pos = ftell(lexer->file);
-    int current_char = lexer->current_char;
-    int line = lexer->line;
-    int column = lexer->column;
+// Consome o token atual se for o operador esperado
+static void parser_eat_op(ParserState *parser, OpKind op)
+{
+    if (!token_is_op(parser->current_token, op))
+    {
+        parser_error(parser, "Erro de sintaxe: Esperado '%s', encontrado '%.*s' na linha %d, coluna %d",
+                op_name(op), TOKEN_ARGS(parser, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    }
+    parser_eat(parser, TOKEN_OPERATOR);
+}
 
-    // Obtém o próximo token
-    Token next_token = lexer_get_next_token(lexer);
+// Registra no nó o trecho do código-fonte que vai de start até o último token consumido
+static ASTNode *parser_span(ParserState *parser, ASTNode *node, Token start)
+{
+    Token last = token_stream_get(&parser->tokens, parser->position ? parser->position - 1 : 0);
+    unsigned int end = last.offset + last.length;
+    node->offset = start.offset;
+    node->length = end > start.offset ? end - start.offset : 0;
+    node->line = (unsigned int)start.line;
+    return node;
+}
 
-    // Restaura o estado do lexer
-    fseek(lexer->file, pos, SEEK_SET);
-    lexer->current_char = current_char;
-    lexer->line = line;
-    lexer->column = column;
+// Olha o k-ésimo token à frente do atual sem consumi-lo
+Token parser_peek(ParserState *parser, size_t k)
+{
+    return parser_token_at(parser, parser->position + k);
+}
 
-    return next_token;
+// Olha o próximo token sem consumi-lo
+Token parser_peek_next_token(ParserState *parser)
+{
+    return parser_peek(parser, 1);
 }
 
 // Prototipação das funções do parser
 ASTNode *parse_expression(ParserState *parser);
-ASTNode *parse_term(ParserState *parser);
+static ASTNode *parse_subexpression(ParserState *parser, int limit);
 ASTNode *parse_factor(ParserState *parser);
 ASTNode *parse_statement(ParserState *parser);
 ASTNode *parse_block(ParserState *parser);
@@ -98,72 +317,53 @@ ASTNode *parse_while_statement(ParserState *parser)
         printf("[Parser] Entrando em parse_while_statement\n");
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'while'
+    Token start = parser->current_token;
+    parser_eat_keyword(parser, KW_WHILE);
 
     ASTNode *condition = parse_expression(parser);
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'do'
+    parser_eat_keyword(parser, KW_DO);
 
     ASTNode *body = parse_block(parser);
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'end'
+    parser_eat_keyword(parser, KW_END);
 
     if (parser->debug_mode)
     {
         printf("[Parser] Saindo de parse_while_statement\n");
     }
 
-    return create_while_statement_node(condition, body);
+    return parser_span(parser, create_while_statement_node(parser->arena, condition, body), start);
 }
 
-// Parsea um fator (número, string, variável, chamada de função ou expressão entre parênteses)
+// Parsea um fator (variável, chamada de função ou expressão entre parênteses)
 ASTNode *parse_factor(ParserState *parser)
 {
     if (parser->debug_mode)
     {
-        printf("[Parser] Entrando em parse_factor com token '%s'\n", parser->current_token.value);
+        printf("[Parser] Entrando em parse_factor com token '%.*s'\n", TOKEN_ARGS(parser, parser->current_token));
     }
 
     Token token = parser->current_token;
 
-    if (token.type == TOKEN_NUMBER)
-    {
-        parser_eat(parser, TOKEN_NUMBER);
-        ASTNode *node = create_number_node(token.value);
-        if (parser->debug_mode)
-        {
-            printf("[Parser] Número reconhecido: %s\n", token.value);
-        }
-        return node;
-    }
-    else if (token.type == TOKEN_STRING)
-    {
-        parser_eat(parser, TOKEN_STRING);
-        ASTNode *node = create_string_node(token.value);
-        if (parser->debug_mode)
-        {
-            printf("[Parser] String reconhecida: \"%s\"\n", token.value);
-        }
-        return node;
-    }
-    else if (token.type == TOKEN_IDENTIFIER)
+    if (token.type == TOKEN_IDENTIFIER)
     {
         Token lookahead = parser_peek_next_token(parser);
         if (lookahead.type == TOKEN_PAREN_OPEN)
         {
             if (parser->debug_mode)
             {
-                printf("[Parser] Reconhecida chamada de função: %s\n", token.value);
+                printf("[Parser] Reconhecida chamada de função: %.*s\n", TOKEN_ARGS(parser, token));
             }
             return parse_function_call(parser);
         }
         else
         {
             parser_eat(parser, TOKEN_IDENTIFIER);
-            ASTNode *node = create_variable_node(token.value);
+            ASTNode *node = parser_span(parser, create_variable_node(parser->arena, token.value.atom), token);
             if (parser->debug_mode)
             {
-                printf("[Parser] Variável reconhecida: %s\n", token.value);
+                printf("[Parser] Variável reconhecida: %.*s\n", TOKEN_ARGS(parser, token));
             }
             return node;
         }
@@ -171,120 +371,97 @@ ASTNode *parse_factor(ParserState *parser)
     else if (token.type == TOKEN_PAREN_OPEN)
     {
         parser_eat(parser, TOKEN_PAREN_OPEN);
-        ASTNode *node = parse_expression(parser);
+        ASTNode *node = parse_subexpression(parser, 0);
         parser_eat(parser, TOKEN_PAREN_CLOSE);
         return node;
     }
     else
     {
-        fprintf(stderr, "Erro de sintaxe: Token inesperado '%s' na linha %d, coluna %d\n",
-                token.value, token.line, token.column);
-        exit(EXIT_FAILURE);
+        parser_error(parser, "Erro de sintaxe: Token inesperado '%.*s' na linha %d, coluna %d",
+                TOKEN_ARGS(parser, token), token.line, token.column);
     }
 }
 
-// Parsea um termo (fatores separados por '*' ou '/')
-ASTNode *parse_term(ParserState *parser)
+/*
+ * Parsea uma expressão por precedence climbing: lê um operando (com seus
+ * operadores unários) e depois consome os operadores binários cujo poder de
+ * ligação à esquerda supera limit. Números e strings são tratados aqui
+ * mesmo, então um operando literal custa uma única chamada.
+ *
+ * Em vez de uma chamada recursiva por operando direito, os operadores que
+ * aguardam o operando ficam em parser->operators, junto com o limite a
+ * restaurar. Assim cadeias como "a .. b .. c ..." ou "- - - x" de qualquer
+ * tamanho usam pilha nativa constante; só parênteses e argumentos de
+ * chamadas voltam a entrar aqui.
+ */
+static ASTNode *parse_subexpression(ParserState *parser, int limit)
 {
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Entrando em parse_term\n");
-    }
+    parser_enter(parser);
+    size_t base = parser->operator_count;
 
-    ASTNode *node = parse_factor(parser);
-
-    while (parser->current_token.type == TOKEN_OPERATOR &&
-           (strcmp(parser->current_token.value, "*") == 0 ||
-            strcmp(parser->current_token.value, "/") == 0 ||
-            strcmp(parser->current_token.value, "%") == 0))
+    for (;;)
     {
-        char operator[MAX_TOKEN_LEN];
-        strncpy(operator, parser->current_token.value, MAX_TOKEN_LEN);
-        parser_eat(parser, TOKEN_OPERATOR);
-        if (parser->debug_mode)
+        Token start = parser->current_token;
+        ASTNode *node;
+        OpKind op = token_op(start);
+
+        if (op == OP_SUB || op == OP_NOT)
         {
-            printf("[Parser] Operador reconhecido em parse_term: %s\n", operator);
+            parser_eat(parser, start.type);
+            if (parser->debug_mode)
+            {
+                printf("[Parser] Operador unário reconhecido: %s\n", op_name(op));
+            }
+            parser_operator_push(parser, op == OP_SUB ? OP_NEG : OP_NOT, NULL, start, limit);
+            limit = UNARY_POWER;
+            continue;
         }
-        ASTNode *right = parse_factor(parser);
-        node = create_binary_op_node(operator, node, right);
-    }
 
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Saindo de parse_term\n");
-    }
-
-    return node;
-}
-
-// Parsea uma expressão aritmética (termos separados por '+' ou '-')
-ASTNode *parse_arithmetic_expression(ParserState *parser)
-{
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Entrando em parse_arithmetic_expression\n");
-    }
-
-    ASTNode *node = parse_term(parser);
-
-    while (parser->current_token.type == TOKEN_OPERATOR &&
-           (strcmp(parser->current_token.value, "+") == 0 ||
-            strcmp(parser->current_token.value, "-") == 0))
-    {
-        char operator[MAX_TOKEN_LEN];
-        strncpy(operator, parser->current_token.value, MAX_TOKEN_LEN);
-        parser_eat(parser, TOKEN_OPERATOR);
-        if (parser->debug_mode)
+        if (start.type == TOKEN_NUMBER)
         {
-            printf("[Parser] Operador reconhecido em parse_arithmetic_expression: %s\n", operator);
+            parser_eat(parser, TOKEN_NUMBER);
+            node = parser_span(parser, create_number_node(parser->arena, start.value.number), start);
         }
-        ASTNode *right = parse_term(parser);
-        node = create_binary_op_node(operator, node, right);
-    }
-
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Saindo de parse_arithmetic_expression\n");
-    }
-
-    return node;
-}
-
-// Parsea uma expressão relacional (expressões aritméticas separadas por operadores relacionais)
-ASTNode *parse_relational_expression(ParserState *parser)
-{
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Entrando em parse_relational_expression\n");
-    }
-
-    ASTNode *node = parse_arithmetic_expression(parser);
-
-    while (parser->current_token.type == TOKEN_OPERATOR &&
-           (strcmp(parser->current_token.value, "==") == 0 ||
-            strcmp(parser->current_token.value, "~=") == 0 ||
-            strcmp(parser->current_token.value, "<") == 0 ||
-            strcmp(parser->current_token.value, ">") == 0 ||
-            strcmp(parser->current_token.value, "<=") == 0 ||
-            strcmp(parser->current_token.value, ">=") == 0))
-    {
-        char operator[MAX_TOKEN_LEN];
-        strncpy(operator, parser->current_token.value, MAX_TOKEN_LEN);
-        parser_eat(parser, TOKEN_OPERATOR);
-        if (parser->debug_mode)
+        else if (start.type == TOKEN_STRING)
         {
-            printf("[Parser] Operador relacional reconhecido: %s\n", operator);
+            parser_eat(parser, TOKEN_STRING);
+            node = parser_span(parser, create_string_node(parser->arena, start.value.atom), start);
+        }
+        else
+        {
+            node = parse_factor(parser);
         }
-        ASTNode *right = parse_arithmetic_expression(parser);
-        node = create_binary_op_node(operator, node, right);
-    }
 
-    if (parser->debug_mode)
-    {
-        printf("[Parser] Saindo de parse_relational_expression\n");
+        // Continua com um operador binário ou fecha os operadores pendentes
+        for (;;)
+        {
+            op = token_op(parser->current_token);
+            if (binary_power[op].left > limit)
+            {
+                parser_eat(parser, parser->current_token.type);
+                if (parser->debug_mode)
+                {
+                    printf("[Parser] Operador binário reconhecido: %s\n", op_name(op));
+                }
+                parser_operator_push(parser, op, node, start, limit);
+                limit = binary_power[op].right;
+                break;
+            }
+            if (parser->operator_count == base)
+            {
+                parser_leave(parser);
+                return node;
+            }
+            ParserOperator pending = parser->operators[--parser->operator_count];
+            if (pending.left)
+                node = create_binary_op_node(parser->arena, pending.op, pending.left, node);
+            else
+                node = create_unary_op_node(parser->arena, pending.op, node);
+            start = pending.start;
+            node = parser_span(parser, node, start);
+            limit = pending.limit;
+        }
     }
-
-    return node;
 }
 
 // Parsea uma expressão geral
@@ -295,7 +472,7 @@ ASTNode *parse_expression(ParserState *parser)
         printf("[Parser] Entrando em parse_expression\n");
     }
 
-    ASTNode *node = parse_relational_expression(parser);
+    ASTNode *node = parse_subexpression(parser, 0);
 
     if (parser->debug_mode)
     {
@@ -313,11 +490,11 @@ ASTNode *parse_assignment(ParserState *parser)
         printf("[Parser] Entrando em parse_assignment\n");
     }
 
-    Token var_token = parser->current_token;
+    Token start = parser->current_token;
     parser_eat(parser, TOKEN_IDENTIFIER);
-    ASTNode *var_node = create_variable_node(var_token.value);
+    ASTNode *var_node = parser_span(parser, create_variable_node(parser->arena, start.value.atom), start);
 
-    parser_eat(parser, TOKEN_OPERATOR); // Espera '='
+    parser_eat_op(parser, OP_ASSIGN);
 
     ASTNode *expr_node = parse_expression(parser);
 
@@ -326,41 +503,100 @@ ASTNode *parse_assignment(ParserState *parser)
         printf("[Parser] Saindo de parse_assignment\n");
     }
 
-    return create_assignment_node(var_node, expr_node);
+    return parser_span(parser, create_assignment_node(parser->arena, var_node, expr_node), start);
 }
 
-// Parsea uma declaração 'if'
-ASTNode *parse_if_statement(ParserState *parser)
+/*
+ * Parsea o restante de um 'if' após a palavra-chave. Cada 'elseif' equivale
+ * a um 'if' aninhado no 'else' do anterior que divide o mesmo 'end'; a
+ * cadeia é montada num laço que guarda o último 'if' aberto, então um 'if'
+ * com qualquer número de 'elseif' usa pilha nativa constante.
+ */
+static ASTNode *parse_if_tail(ParserState *parser, Token start)
 {
-    if (parser->debug_mode)
+    ASTNode *head = NULL;
+    ASTNode *last = NULL;
+
+    for (;;)
     {
-        printf("[Parser] Entrando em parse_if_statement\n");
+        ASTNode *condition = parse_expression(parser);
+
+        parser_eat_keyword(parser, KW_THEN);
+
+        ASTNode *then_branch = parse_block(parser);
+
+        ASTNode *node = create_if_statement_node(parser->arena, condition, then_branch, NULL);
+        node->offset = start.offset;
+        node->line = (unsigned int)start.line;
+        if (last)
+        {
+            ASTNode *else_branch = create_block_node(parser->arena);
+            else_branch->block.statements = arena_alloc(parser->arena, sizeof(ASTNode *));
+            else_branch->block.statements[0] = node;
+            else_branch->block.statement_count = 1;
+            else_branch->offset = start.offset;
+            else_branch->line = (unsigned int)start.line;
+            last->if_statement.else_branch = else_branch;
+        }
+        else
+        {
+            head = node;
+        }
+        last = node;
+
+        if (!parser_at_keyword(parser, KW_ELSEIF))
+        {
+            break;
+        }
+        start = parser->current_token;
+        parser_eat_keyword(parser, KW_ELSEIF);
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'if'
+    if (parser_at_keyword(parser, KW_ELSE))
+    {
+        parser_eat_keyword(parser, KW_ELSE);
+        last->if_statement.else_branch = parse_block(parser);
+    }
 
-    ASTNode *condition = parse_expression(parser);
+    parser_eat_keyword(parser, KW_END);
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'then'
+    // Todos os trechos da cadeia terminam no mesmo 'end'
+    Token end_token = token_stream_get(&parser->tokens, parser->position - 1);
+    unsigned int end = end_token.offset + end_token.length;
+    for (ASTNode *node = head; node; )
+    {
+        node->length = end - node->offset;
+        ASTNode *else_branch = node->if_statement.else_branch;
+        if (node == last || !else_branch)
+        {
+            break;
+        }
+        else_branch->length = end - else_branch->offset;
+        node = else_branch->block.statements[0];
+    }
 
-    ASTNode *then_branch = parse_block(parser);
+    return head;
+}
 
-    ASTNode *else_branch = NULL;
-    if (parser->current_token.type == TOKEN_KEYWORD &&
-        strcmp(parser->current_token.value, "else") == 0)
+// Parsea uma declaração 'if'
+ASTNode *parse_if_statement(ParserState *parser)
+{
+    if (parser->debug_mode)
     {
-        parser_eat(parser, TOKEN_KEYWORD); // 'else'
-        else_branch = parse_block(parser);
+        printf("[Parser] Entrando em parse_if_statement\n");
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'end'
+    Token start = parser->current_token;
+    parser_eat_keyword(parser, KW_IF);
+
+    ASTNode *node = parse_if_tail(parser, start);
 
     if (parser->debug_mode)
     {
         printf("[Parser] Saindo de parse_if_statement\n");
     }
 
-    return create_if_statement_node(condition, then_branch, else_branch);
+    return node;
 }
 
 // Parsea uma chamada de função
@@ -368,32 +604,26 @@ ASTNode *parse_function_call(ParserState *parser)
 {
     if (parser->debug_mode)
     {
-        printf("[Parser] Entrando em parse_function_call com token '%s'\n", parser->current_token.value);
+        printf("[Parser] Entrando em parse_function_call com token '%.*s'\n", TOKEN_ARGS(parser, parser->current_token));
     }
 
-    Token token = parser->current_token;
+    Token start = parser->current_token;
+    Atom function_name = start.value.atom;
     parser_eat(parser, TOKEN_IDENTIFIER);
 
     parser_eat(parser, TOKEN_PAREN_OPEN);
 
     // Lista de argumentos
-    ASTNode **arguments = NULL;
-    int arg_count = 0;
+    size_t mark = parser->scratch_count;
+    ASTNode **arguments;
+    int arg_count;
 
     // Verifica se há argumentos
     if (parser->current_token.type != TOKEN_PAREN_CLOSE)
     {
         do
         {
-            ASTNode *arg = parse_expression(parser);
-            arg_count++;
-            arguments = realloc(arguments, arg_count * sizeof(ASTNode *));
-            if (!arguments)
-            {
-                perror("Erro de alocação de memória");
-                exit(EXIT_FAILURE);
-            }
-            arguments[arg_count - 1] = arg;
+            parser_scratch_push(parser, parse_expression(parser));
 
             if (parser->current_token.type == TOKEN_COMMA)
             {
@@ -407,13 +637,14 @@ ASTNode *parse_function_call(ParserState *parser)
     }
 
     parser_eat(parser, TOKEN_PAREN_CLOSE);
+    arguments = parser_scratch_pop(parser, mark, &arg_count);
 
     if (parser->debug_mode)
     {
         printf("[Parser] Saindo de parse_function_call\n");
     }
 
-    return create_function_call_node(token.value, arguments, arg_count);
+    return parser_span(parser, create_function_call_node(parser->arena, function_name, arguments, arg_count), start);
 }
 
 
@@ -425,26 +656,27 @@ ASTNode *parse_function_declaration(ParserState *parser)
         printf("[Parser] Entrando em parse_function_declaration\n");
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'function'
+    Token start = parser->current_token;
+    parser_eat_keyword(parser, KW_FUNCTION);
 
-    char function_name[MAX_TOKEN_LEN] = {0};
+    Atom function_name = ATOM_NONE;
     if (parser->current_token.type == TOKEN_IDENTIFIER)
     {
-        strncpy(function_name, parser->current_token.value, MAX_TOKEN_LEN);
+        function_name = parser->current_token.value.atom;
         parser_eat(parser, TOKEN_IDENTIFIER);
     }
     else
     {
-        fprintf(stderr, "Erro de sintaxe: Esperado nome da função na linha %d, coluna %d\n",
+        parser_error(parser, "Erro de sintaxe: Esperado nome da função na linha %d, coluna %d",
                 parser->current_token.line, parser->current_token.column);
-        exit(EXIT_FAILURE);
     }
 
     parser_eat(parser, TOKEN_PAREN_OPEN);
 
     // Lista de parâmetros
-    ASTNode **parameters = NULL;
-    int param_count = 0;
+    size_t mark = parser->scratch_count;
+    ASTNode **parameters;
+    int param_count;
 
     if (parser->current_token.type != TOKEN_PAREN_CLOSE)
     {
@@ -452,17 +684,9 @@ ASTNode *parse_function_declaration(ParserState *parser)
         {
             if (parser->current_token.type == TOKEN_IDENTIFIER)
             {
-                ASTNode *param_node = create_function_parameter_node(parser->current_token.value);
+                Token param = parser->current_token;
                 parser_eat(parser, TOKEN_IDENTIFIER);
-
-                param_count++;
-                parameters = realloc(parameters, param_count * sizeof(ASTNode *));
-                if (!parameters)
-                {
-                    perror("Erro de alocação de memória");
-                    exit(EXIT_FAILURE);
-                }
-                parameters[param_count - 1] = param_node;
+                parser_scratch_push(parser, parser_span(parser, create_function_parameter_node(parser->arena, param.value.atom), param));
 
                 if (parser->current_token.type == TOKEN_COMMA)
                 {
@@ -475,21 +699,21 @@ ASTNode *parse_function_declaration(ParserState *parser)
             }
             else
             {
-                fprintf(stderr, "Erro de sintaxe: Esperado nome do parâmetro na linha %d, coluna %d\n",
+                parser_error(parser, "Erro de sintaxe: Esperado nome do parâmetro na linha %d, coluna %d",
                         parser->current_token.line, parser->current_token.column);
-                exit(EXIT_FAILURE);
             }
         } while (1);
     }
 
     parser_eat(parser, TOKEN_PAREN_CLOSE);
+    parameters = parser_scratch_pop(parser, mark, &param_count);
 
     // Corpo da função
     ASTNode *body = parse_block(parser);
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'end'
+    parser_eat_keyword(parser, KW_END);
 
-    ASTNode *node = create_function_declaration_node(function_name, parameters, param_count, body);
+    ASTNode *node = parser_span(parser, create_function_declaration_node(parser->arena, function_name, parameters, param_count, body), start);
 
     if (parser->debug_mode)
     {
@@ -506,17 +730,18 @@ ASTNode *parse_return_statement(ParserState *parser)
         printf("[Parser] Entrando em parse_return_statement\n");
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); // 'return'
+    Token start = parser->current_token;
+    parser_eat_keyword(parser, KW_RETURN);
 
     ASTNode *expr = NULL;
     if (parser->current_token.type != TOKEN_SEMICOLON &&
         parser->current_token.type != TOKEN_EOF &&
-        !(parser->current_token.type == TOKEN_KEYWORD && strcmp(parser->current_token.value, "end") == 0))
+        !parser_at_keyword(parser, KW_END))
     {
         expr = parse_expression(parser);
     }
 
-    ASTNode *node = create_return_statement_node(expr);
+    ASTNode *node = parser_span(parser, create_return_statement_node(parser->arena, expr), start);
 
     if (parser->debug_mode)
     {
@@ -533,43 +758,41 @@ ASTNode *parse_variable_declaration(ParserState *parser)
         printf("[Parser] Entrando em parse_variable_declaration\n");
     }
 
-    parser_eat(parser, TOKEN_KEYWORD); 
+    Token start = parser->current_token;
+    parser_eat_keyword(parser, KW_LOCAL);
 
     if (parser->current_token.type != TOKEN_IDENTIFIER)
     {
-        fprintf(stderr, "Erro de sintaxe: Esperado nome de variável após 'local' na linha %d, coluna %d\n",
+        parser_error(parser, "Erro de sintaxe: Esperado nome de variável após 'local' na linha %d, coluna %d",
                 parser->current_token.line, parser->current_token.column);
-        exit(EXIT_FAILURE);
     }
 
-    char variable_name[MAX_TOKEN_LEN];
-    strncpy(variable_name, parser->current_token.value, MAX_TOKEN_LEN);
+    Atom variable_name = parser->current_token.value.atom;
     parser_eat(parser, TOKEN_IDENTIFIER);
 
-    char type_name[MAX_TOKEN_LEN] = {0};
+    Atom type_name = ATOM_NONE;
     if (parser->current_token.type == TOKEN_COLON)
     {
         parser_eat(parser, TOKEN_COLON);
 
         if (parser->current_token.type != TOKEN_IDENTIFIER)
         {
-            fprintf(stderr, "Erro de sintaxe: Esperado nome de tipo após ':' na linha %d, coluna %d\n",
+            parser_error(parser, "Erro de sintaxe: Esperado nome de tipo após ':' na linha %d, coluna %d",
                     parser->current_token.line, parser->current_token.column);
-            exit(EXIT_FAILURE);
         }
 
-        strncpy(type_name, parser->current_token.value, MAX_TOKEN_LEN);
+        type_name = parser->current_token.value.atom;
         parser_eat(parser, TOKEN_IDENTIFIER);
     }
 
     ASTNode *expression = NULL;
-    if (parser->current_token.type == TOKEN_OPERATOR && strcmp(parser->current_token.value, "=") == 0)
+    if (token_is_op(parser->current_token, OP_ASSIGN))
     {
         parser_eat(parser, TOKEN_OPERATOR); // '='
         expression = parse_expression(parser);
     }
 
-    ASTNode *node = create_variable_declaration_node(variable_name, type_name, expression);
+    ASTNode *node = parser_span(parser, create_variable_declaration_node(parser->arena, variable_name, type_name, expression), start);
 
     if (parser->debug_mode)
     {
@@ -583,41 +806,32 @@ ASTNode *parse_statement(ParserState *parser)
 {
     if (parser->debug_mode)
     {
-        printf("[Parser] Entrando em parse_statement com token '%s'\n", parser->current_token.value);
+        printf("[Parser] Entrando em parse_statement com token '%.*s'\n", TOKEN_ARGS(parser, parser->current_token));
     }
 
     if (parser->current_token.type == TOKEN_KEYWORD)
     {
-        if (strcmp(parser->current_token.value, "if") == 0)
+        switch (parser->current_token.value.keyword)
         {
+        case KW_IF:
             return parse_if_statement(parser);
-        }
-        else if(strcmp(parser->current_token.value, "local") == 0) {
-             return parse_variable_declaration(parser);
-        }
-        else if (strcmp(parser->current_token.value, "while") == 0)
-        {
+        case KW_LOCAL:
+            return parse_variable_declaration(parser);
+        case KW_WHILE:
             return parse_while_statement(parser);
-        }
-        else if (strcmp(parser->current_token.value, "function") == 0)
-        {
+        case KW_FUNCTION:
             return parse_function_declaration(parser);
-        }
-        else if (strcmp(parser->current_token.value, "return") == 0)
-        {
+        case KW_RETURN:
             return parse_return_statement(parser);
-        }
-        else
-        {
-            fprintf(stderr, "Erro de sintaxe: Palavra-chave inesperada '%s' na linha %d, coluna %d\n",
-                    parser->current_token.value, parser->current_token.line, parser->current_token.column);
-            exit(EXIT_FAILURE);
+        default:
+            parser_error(parser, "Erro de sintaxe: Palavra-chave inesperada '%.*s' na linha %d, coluna %d",
+                    TOKEN_ARGS(parser, parser->current_token), parser->current_token.line, parser->current_token.column);
         }
     }
     else if (parser->current_token.type == TOKEN_IDENTIFIER)
     {
         Token lookahead = parser_peek_next_token(parser);
-        if (lookahead.type == TOKEN_OPERATOR && strcmp(lookahead.value, "=") == 0)
+        if (token_is_op(lookahead, OP_ASSIGN))
         {
             return parse_assignment(parser);
         }
@@ -627,16 +841,14 @@ ASTNode *parse_statement(ParserState *parser)
         }
         else
         {
-            fprintf(stderr, "Erro de sintaxe: Declaração inválida iniciada com '%s' na linha %d, coluna %d\n",
-                    parser->current_token.value, parser->current_token.line, parser->current_token.column);
-            exit(EXIT_FAILURE);
+            parser_error(parser, "Erro de sintaxe: Declaração inválida iniciada com '%.*s' na linha %d, coluna %d",
+                    TOKEN_ARGS(parser, parser->current_token), parser->current_token.line, parser->current_token.column);
         }
     }
     else
     {
-        fprintf(stderr, "Erro de sintaxe: Token inesperado '%s' na linha %d, coluna %d\n",
-                parser->current_token.value, parser->current_token.line, parser->current_token.column);
-        exit(EXIT_FAILURE);
+        parser_error(parser, "Erro de sintaxe: Token inesperado '%.*s' na linha %d, coluna %d",
+                TOKEN_ARGS(parser, parser->current_token), parser->current_token.line, parser->current_token.column);
     }
 }
 
@@ -647,24 +859,16 @@ ASTNode *parse_block(ParserState *parser)
         printf("[Parser] Entrando em parse_block\n");
     }
 
-    ASTNode *block = create_block_node();
+    parser_enter(parser);
+    Token start = parser->current_token;
+    size_t mark = parser->scratch_count;
 
     while (parser->current_token.type != TOKEN_EOF &&
-           !(parser->current_token.type == TOKEN_KEYWORD &&
-             (strcmp(parser->current_token.value, "end") == 0 ||
-              strcmp(parser->current_token.value, "else") == 0 ||
-              strcmp(parser->current_token.value, "elseif") == 0)))
+           !parser_at_keyword(parser, KW_END) &&
+           !parser_at_keyword(parser, KW_ELSE) &&
+           !parser_at_keyword(parser, KW_ELSEIF))
     {
-        ASTNode *statement = parse_statement(parser);
-
-        block->block.statement_count++;
-        block->block.statements = realloc(block->block.statements, block->block.statement_count * sizeof(ASTNode *));
-        if (!block->block.statements)
-        {
-            perror("Erro de alocação de memória");
-            exit(EXIT_FAILURE);
-        }
-        block->block.statements[block->block.statement_count - 1] = statement;
+        parser_scratch_push(parser, parse_statement(parser));
 
         if (parser->current_token.type == TOKEN_SEMICOLON)
         {
@@ -677,7 +881,44 @@ ASTNode *parse_block(ParserState *parser)
         printf("[Parser] Saindo de parse_block\n");
     }
 
-    return block;
+    ASTNode *block = create_block_node(parser->arena);
+    block->block.statements = parser_scratch_pop(parser, mark, &block->block.statement_count);
+    parser_leave(parser);
+    return parser_span(parser, block, start);
+}
+
+ASTNode *parse_next_toplevel(ParserState *parser)
+{
+    // Os tokens dos comandos anteriores não serão mais lidos
+    token_stream_discard(&parser->tokens, parser->position);
+    parser->position = 0;
+
+    while (parser->current_token.type == TOKEN_SEMICOLON)
+    {
+        parser_eat(parser, TOKEN_SEMICOLON);
+    }
+
+    if (parser->current_token.type == TOKEN_EOF)
+    {
+        return NULL;
+    }
+
+    if (parser_at_keyword(parser, KW_END) || parser_at_keyword(parser, KW_ELSE) ||
+        parser_at_keyword(parser, KW_ELSEIF))
+    {
+        parser_error(parser, "Erro de sintaxe: '%.*s' inesperado na linha %d, coluna %d",
+                TOKEN_ARGS(parser, parser->current_token),
+                parser->current_token.line, parser->current_token.column);
+    }
+
+    ASTNode *statement = parse_statement(parser);
+
+    if (parser->current_token.type == TOKEN_SEMICOLON)
+    {
+        parser_eat(parser, TOKEN_SEMICOLON);
+    }
+
+    return statement;
 }
 
 ASTNode *parse(ParserState *parser)
@@ -687,7 +928,19 @@ ASTNode *parse(ParserState *parser)
         printf("[Parser] Iniciando análise sintática\n");
     }
 
-    ASTNode *ast = parse_block(parser);
+    Token start = parser->current_token;
+    size_t mark = parser->scratch_count;
+    ASTNode *statement;
+    while ((statement = parse_next_toplevel(parser)) != NULL)
+    {
+        parser_scratch_push(parser, statement);
+    }
+
+    ASTNode *ast = create_block_node(parser->arena);
+    ast->block.statements = parser_scratch_pop(parser, mark, &ast->block.statement_count);
+    ast->offset = start.offset;
+    ast->length = parser->current_token.offset - start.offset;
+    ast->line = (unsigned int)start.line;
 
     if (parser->debug_mode)
     {
@@ -2,9 +2,44 @@
 #include "symbol_table.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 
-static EnvEntry *env = NULL;
-static int next_type_var = 0;
+static Type *prune(Type *t);
+
+/*
+ * Regra de tipo de cada operador: os operandos são unificados com operand e
+ * o resultado tem o tipo result. Quando operand é TYPE_UNKNOWN, os operandos
+ * só precisam ter o mesmo tipo entre si; quando result é TYPE_UNKNOWN, o
+ * resultado tem o tipo dos operandos (and/or devolvem um deles).
+ */
+typedef struct
+{
+    DataType operand;
+    DataType result;
+} OpTypeRule;
+
+static const OpTypeRule op_type_rules[OP_COUNT] = {
+    [OP_NONE] = {TYPE_UNKNOWN, TYPE_UNKNOWN},
+    [OP_ADD] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_SUB] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_MUL] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_DIV] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_MOD] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_EQ] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_NE] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_LT] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_LE] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_GT] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_GE] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_POW] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_CONCAT] = {TYPE_STRING, TYPE_STRING},
+    [OP_AND] = {TYPE_UNKNOWN, TYPE_UNKNOWN},
+    [OP_OR] = {TYPE_UNKNOWN, TYPE_UNKNOWN},
+    [OP_NOT] = {TYPE_UNKNOWN, TYPE_BOOLEAN},
+    [OP_NEG] = {TYPE_NUMBER, TYPE_NUMBER},
+    [OP_ASSIGN] = {TYPE_UNKNOWN, TYPE_UNKNOWN},
+};
 
 static DataType type_to_datatype(Type *t)
 {
@@ -20,314 +55,902 @@ static DataType type_to_datatype(Type *t)
     }
 }
 
-static Type *new_type_var(void)
+// Bloco livre de uma classe de tamanho (o próximo fica nos primeiros bytes)
+typedef struct FreeBlock
+{
+    struct FreeBlock *next;
+} FreeBlock;
+
+static size_t size_class(size_t size)
+{
+    return (size + 7) / 8 - 1;
+}
+
+/*
+ * Reserva size bytes na arena de tipos, reaproveitando um bloco devolvido
+ * com semantic_release quando houver um do mesmo tamanho.
+ */
+static void *semantic_alloc(SemanticState *s, size_t size)
+{
+    size_t c = size_class(size);
+    if (c < SEMANTIC_FREE_CLASSES && s->free_blocks[c])
+    {
+        FreeBlock *block = s->free_blocks[c];
+        s->free_blocks[c] = block->next;
+        return block;
+    }
+    return arena_alloc(&s->types, size);
+}
+
+// Devolve um bloco temporário; blocos grandes ficam na arena até o fim
+static void semantic_release(SemanticState *s, void *ptr, size_t size)
+{
+    size_t c = size_class(size);
+    if (!ptr || size == 0 || c >= SEMANTIC_FREE_CLASSES)
+        return;
+    FreeBlock *block = ptr;
+    block->next = s->free_blocks[c];
+    s->free_blocks[c] = block;
+}
+
+// Garante espaço para mais um item em um vetor que cresce dobrando
+static void *semantic_reserve(void *items, size_t count, size_t *capacity, size_t item_size)
+{
+    if (count < *capacity)
+        return items;
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    items = realloc(items, new_capacity * item_size);
+    if (!items)
+    {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = new_capacity;
+    return items;
+}
+
+static void pair_push(SemanticState *s, Type *a, Type *b)
 {
-    Type *t = malloc(sizeof(Type));
+    s->pairs = semantic_reserve(s->pairs, s->pair_count, &s->pair_capacity, sizeof(TypePair));
+    s->pairs[s->pair_count].a = a;
+    s->pairs[s->pair_count].b = b;
+    s->pair_count++;
+}
+
+static void value_push(SemanticState *s, Type *t)
+{
+    s->values = semantic_reserve(s->values, s->value_count, &s->value_capacity, sizeof(Type *));
+    s->values[s->value_count++] = t;
+}
+
+static Type *new_type_var(SemanticState *s)
+{
+    Type *t = semantic_alloc(s, sizeof(Type));
     t->kind = TVAR;
-    t->var_id = next_type_var++;
+    t->var_id = s->next_type_var++;
+    t->rank = 0;
+    t->level = s->level;
+    t->parent = NULL;
     t->instance = NULL;
+    t->copy = NULL;
     return t;
 }
 
+/*
+ * Instância única de cada tipo primitivo. Os objetos nunca são modificados,
+ * então podem ser compartilhados entre compilações paralelas.
+ */
+static Type prim_types[] = {
+    [TYPE_NIL] = {.kind = TPRIM, .prim = TYPE_NIL},
+    [TYPE_NUMBER] = {.kind = TPRIM, .prim = TYPE_NUMBER},
+    [TYPE_STRING] = {.kind = TPRIM, .prim = TYPE_STRING},
+    [TYPE_BOOLEAN] = {.kind = TPRIM, .prim = TYPE_BOOLEAN},
+    [TYPE_FUNCTION] = {.kind = TPRIM, .prim = TYPE_FUNCTION},
+    [TYPE_TABLE] = {.kind = TPRIM, .prim = TYPE_TABLE},
+    [TYPE_UNKNOWN] = {.kind = TPRIM, .prim = TYPE_UNKNOWN},
+};
+
 static Type *new_prim(DataType p)
 {
-    Type *t = malloc(sizeof(Type));
-    t->kind = TPRIM;
-    t->prim = p;
-    t->instance = NULL;
-    return t;
+    return &prim_types[p];
 }
 
-static Type *new_fun(Type *arg, Type *ret)
+static size_t fun_hash(const Type *arg, const Type *ret)
 {
-    Type *t = malloc(sizeof(Type));
+    size_t h = (size_t)(uintptr_t)arg * 0x9E3779B97F4A7C15ull;
+    h ^= (size_t)(uintptr_t)ret + (h << 6) + (h >> 2);
+    return h ^ (h >> 29);
+}
+
+static void fun_table_grow(SemanticState *s)
+{
+    size_t capacity = s->fun_capacity ? s->fun_capacity * 2 : 256;
+    Type **table = calloc(capacity, sizeof(Type *));
+    if (!table)
+    {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < s->fun_capacity; i++)
+    {
+        Type *t = s->fun_types[i];
+        if (!t)
+            continue;
+        size_t j = fun_hash(t->arg, t->ret) & (capacity - 1);
+        while (table[j])
+            j = (j + 1) & (capacity - 1);
+        table[j] = t;
+    }
+    free(s->fun_types);
+    s->fun_types = table;
+    s->fun_capacity = capacity;
+}
+
+/*
+ * Tipo de função arg -> ret. Os componentes são podados antes da busca, e
+ * funções com os mesmos componentes compartilham um único nó.
+ */
+static Type *new_fun(SemanticState *s, Type *arg, Type *ret)
+{
+    arg = prune(arg);
+    ret = prune(ret);
+    if ((s->fun_count + 1) * 4 > s->fun_capacity * 3)
+        fun_table_grow(s);
+
+    size_t mask = s->fun_capacity - 1;
+    size_t i = fun_hash(arg, ret) & mask;
+    for (Type *t; (t = s->fun_types[i]) != NULL; i = (i + 1) & mask)
+    {
+        if (t->arg == arg && t->ret == ret)
+            return t;
+    }
+
+    Type *t = semantic_alloc(s, sizeof(Type));
     t->kind = TFUN;
     t->arg = arg;
     t->ret = ret;
     t->instance = NULL;
+    t->copy = NULL;
+    s->fun_types[i] = t;
+    s->fun_count++;
     return t;
 }
 
-static Type *prune(Type *t)
+// Raiz da classe de uma variável, comprimindo o caminho percorrido
+static Type *find_root(Type *t)
 {
-    if (t->kind == TVAR && t->instance)
+    Type *root = t;
+    while (root->parent)
+        root = root->parent;
+    while (t != root)
     {
-        t->instance = prune(t->instance);
-        return t->instance;
+        Type *next = t->parent;
+        t->parent = root;
+        t = next;
     }
-    return t;
+    return root;
 }
 
-static int occurs_in(int id, Type *t)
+// Representante de um tipo: o tipo ligado à classe da variável, ou a raiz livre
+static Type *prune(Type *t)
 {
-    t = prune(t);
-    if (t->kind == TVAR)
-        return t->var_id == id;
-    if (t->kind == TFUN)
-        return occurs_in(id, t->arg) || occurs_in(id, t->ret);
-    return 0;
+    if (t->kind != TVAR)
+        return t;
+    Type *root = find_root(t);
+    return root->instance ? root->instance : root;
 }
 
-static void unify(Type *a, Type *b)
+/*
+ * Verifica se a variável v ocorre em t e, no caminho, rebaixa para o nível
+ * de v as variáveis de t criadas em níveis mais internos: depois da ligação
+ * elas passam a ser alcançáveis a partir de v e não podem ser generalizadas
+ * antes dela.
+ */
+static int occurs_in(SemanticState *s, Type *v, Type *t)
 {
-    a = prune(a);
-    b = prune(b);
-    if (a->kind == TVAR)
+    size_t base = s->pair_count;
+    pair_push(s, t, NULL);
+    while (s->pair_count > base)
     {
-        if (a != b)
+        t = prune(s->pairs[--s->pair_count].a);
+        if (t->kind == TVAR)
         {
-            if (occurs_in(a->var_id, b))
+            if (t == v)
             {
-                fprintf(stderr, "Erro: ocorrência circular em unificação.\n");
-                exit(1);
+                s->pair_count = base;
+                return 1;
             }
-            a->instance = b;
+            if (t->level > v->level)
+                t->level = v->level;
         }
-    }
-    else if (b->kind == TVAR)
-    {
-        unify(b, a);
-    }
-    else if (a->kind == TPRIM && b->kind == TPRIM)
-    {
-        if (a->prim != b->prim)
+        else if (t->kind == TFUN)
         {
-            fprintf(stderr, "Erro: tipos primitivos incompatíveis.\n");
-            exit(1);
+            pair_push(s, t->ret, NULL);
+            pair_push(s, t->arg, NULL);
         }
     }
-    else if (a->kind == TFUN && b->kind == TFUN)
-    {
-        unify(a->arg, b->arg);
-        unify(a->ret, b->ret);
-    }
-    else
-    {
-        fprintf(stderr, "Erro: unificação de tipos incompatíveis.\n");
-        exit(1);
-    }
+    return 0;
 }
 
-static void env_add(const char *name, TypeScheme *sch)
+// Liga a variável livre v ao tipo t, que não é uma variável
+static void bind_var(SemanticState *s, Type *v, Type *t, unsigned int line)
 {
-    EnvEntry *e = malloc(sizeof(EnvEntry));
-    size_t len = strlen(name) + 1;
-    e->name = malloc(len);
-    if (!e->name)
+    if (occurs_in(s, v, t))
     {
-        perror("malloc");
-        exit(1);
+        diagnostics_fatal(s->diagnostics, (int)line, 0,
+                          "Erro: ocorrência circular em unificação na linha %u.", line);
     }
-    memcpy(e->name, name, len);
-    e->scheme = sch;
-    e->next = env;
-    env = e;
+    v->instance = t;
 }
 
-static TypeScheme *env_lookup(const char *name)
+// Unifica a e b; pares de componentes de funções ficam na pilha de trabalho
+static void unify(SemanticState *s, Type *a, Type *b, unsigned int line)
 {
-    for (EnvEntry *e = env; e; e = e->next)
+    size_t base = s->pair_count;
+    pair_push(s, a, b);
+    while (s->pair_count > base)
     {
-        if (strcmp(e->name, name) == 0)
-            return e->scheme;
+        TypePair pair = s->pairs[--s->pair_count];
+        a = prune(pair.a);
+        b = prune(pair.b);
+        if (a == b)
+            continue;
+        if (a->kind == TVAR && b->kind == TVAR)
+        {
+            // União por posto: a árvore mais baixa passa a apontar para a mais alta.
+            // A raiz que sobra fica com o menor dos dois níveis.
+            int level = a->level < b->level ? a->level : b->level;
+            if (a->rank < b->rank)
+            {
+                a->parent = b;
+                b->level = level;
+            }
+            else
+            {
+                b->parent = a;
+                a->level = level;
+                if (a->rank == b->rank)
+                    a->rank++;
+            }
+        }
+        else if (a->kind == TVAR)
+        {
+            bind_var(s, a, b, line);
+        }
+        else if (b->kind == TVAR)
+        {
+            bind_var(s, b, a, line);
+        }
+        else if (a->kind == TPRIM && b->kind == TPRIM)
+        {
+            if (a->prim != b->prim)
+            {
+                diagnostics_fatal(s->diagnostics, (int)line, 0,
+                                  "Erro: tipos primitivos incompatíveis na linha %u.", line);
+            }
+        }
+        else if (a->kind == TFUN && b->kind == TFUN)
+        {
+            pair_push(s, a->ret, b->ret);
+            pair_push(s, a->arg, b->arg);
+        }
+        else
+        {
+            diagnostics_fatal(s->diagnostics, (int)line, 0,
+                              "Erro: unificação de tipos incompatíveis na linha %u.", line);
+        }
     }
-    return NULL;
 }
 
-static void ftv_type(Type *t, int *seen, int *count)
+/*
+ * Ambiente com escopos: a tabela bindings guarda, para cada nome, a ligação
+ * visível no momento, e o registro undo permite desfazer as declarações de
+ * um escopo ao sair dele. Consultas, declarações e a saída de um escopo
+ * custam O(1) por nome, independentemente do tamanho do programa.
+ */
+static void env_add(SemanticState *s, Atom name, TypeScheme *sch)
 {
-    t = prune(t);
-    if (t->kind == TVAR)
+    if (s->undo_count == s->undo_capacity)
     {
-        if (!seen[t->var_id])
+        size_t capacity = s->undo_capacity ? s->undo_capacity * 2 : 64;
+        EnvEntry *undo = realloc(s->undo, capacity * sizeof(EnvEntry));
+        if (!undo)
         {
-            seen[t->var_id] = 1;
-            (*count)++;
+            perror("Erro de alocação de memória");
+            exit(EXIT_FAILURE);
         }
+        s->undo = undo;
+        s->undo_capacity = capacity;
     }
-    else if (t->kind == TFUN)
+    s->undo[s->undo_count].name = name;
+    s->undo[s->undo_count].shadowed = symbol_table_insert(&s->bindings, name, sch);
+    s->undo_count++;
+}
+
+static TypeScheme *env_lookup(SemanticState *s, Atom name)
+{
+    return symbol_table_lookup_local(&s->bindings, name);
+}
+
+// Abre um escopo; o valor devolvido é passado a env_leave
+static size_t env_enter(SemanticState *s)
+{
+    return s->undo_count;
+}
+
+// Desfaz, da mais recente para a mais antiga, as declarações do escopo
+static void env_leave(SemanticState *s, size_t mark)
+{
+    while (s->undo_count > mark)
     {
-        ftv_type(t->arg, seen, count);
-        ftv_type(t->ret, seen, count);
+        EnvEntry *e = &s->undo[--s->undo_count];
+        if (e->shadowed)
+            symbol_table_insert(&s->bindings, e->name, e->shadowed);
+        else
+            symbol_table_remove(&s->bindings, e->name);
     }
 }
 
-static TypeScheme *generalize(Type *t)
+// Variáveis genéricas encontradas durante uma generalização
+typedef struct
+{
+    Type **items;
+    int count;
+    int capacity;
+} TypeVarList;
+
+/*
+ * Torna genéricas as variáveis livres de t criadas em níveis mais internos
+ * que o atual. Cada variável é marcada com TYPE_LEVEL_GENERIC na primeira
+ * visita, o que também evita duplicatas na lista.
+ */
+static void generalize_vars(SemanticState *s, Type *t, TypeVarList *list)
 {
-    int max = next_type_var;
-    int *seen = calloc(max, sizeof(int));
-    int tot = 0;
-    ftv_type(t, seen, &tot);
-    int *vars = malloc(tot * sizeof(int));
-    int idx = 0;
-    for (int i = 0; i < max; i++)
+    size_t base = s->pair_count;
+    pair_push(s, t, NULL);
+    while (s->pair_count > base)
     {
-        if (seen[i])
-            vars[idx++] = i;
+        t = prune(s->pairs[--s->pair_count].a);
+        if (t->kind == TVAR)
+        {
+            if (t->level == TYPE_LEVEL_GENERIC || t->level <= s->level)
+                continue;
+            t->level = TYPE_LEVEL_GENERIC;
+            if (list->count == list->capacity)
+            {
+                int capacity = list->capacity ? list->capacity * 2 : 4;
+                Type **items = semantic_alloc(s, capacity * sizeof(Type *));
+                if (list->count)
+                    memcpy(items, list->items, list->count * sizeof(Type *));
+                semantic_release(s, list->items, list->capacity * sizeof(Type *));
+                list->items = items;
+                list->capacity = capacity;
+            }
+            list->items[list->count++] = t;
+        }
+        else if (t->kind == TFUN)
+        {
+            pair_push(s, t->ret, NULL);
+            pair_push(s, t->arg, NULL);
+        }
     }
-    TypeScheme *sch = malloc(sizeof(TypeScheme));
-    sch->var_count = tot;
-    sch->vars = vars;
+}
+
+static TypeScheme *generalize(SemanticState *s, Type *t)
+{
+    TypeVarList list = {NULL, 0, 0};
+    generalize_vars(s, t, &list);
+    TypeScheme *sch = semantic_alloc(s, sizeof(TypeScheme));
+    sch->var_count = list.count;
+    sch->vars = list.items;
     sch->type = t;
-    free(seen);
     return sch;
 }
 
-static Type *copy_type(Type *t, Type **map)
+// Esquema sem variáveis genéricas (parâmetros e ligações recursivas)
+static TypeScheme *monomorphic(SemanticState *s, Type *t)
 {
-    t = prune(t);
-    if (t->kind == TVAR)
+    TypeScheme *sch = semantic_alloc(s, sizeof(TypeScheme));
+    sch->var_count = 0;
+    sch->vars = NULL;
+    sch->type = t;
+    return sch;
+}
+
+/*
+ * Copia t em pós-ordem. Na pilha de trabalho, (t, NULL) pede a visita de t
+ * e (NULL, f) pede a montagem da função f a partir das cópias dos seus
+ * componentes, que estão no topo da pilha de valores. Primitivos e funções
+ * sem variáveis genéricas são reaproveitados.
+ */
+static Type *copy_type(SemanticState *s, Type *t)
+{
+    size_t base = s->pair_count;
+    pair_push(s, t, NULL);
+    while (s->pair_count > base)
     {
-        return map[t->var_id] ? map[t->var_id] : t;
+        TypePair pair = s->pairs[--s->pair_count];
+        if (pair.a)
+        {
+            t = prune(pair.a);
+            if (t->kind == TVAR)
+            {
+                value_push(s, t->copy ? t->copy : t);
+            }
+            else if (t->kind == TPRIM)
+            {
+                value_push(s, t);
+            }
+            else
+            {
+                pair_push(s, NULL, t);
+                pair_push(s, t->ret, NULL);
+                pair_push(s, t->arg, NULL);
+            }
+        }
+        else
+        {
+            t = pair.b;
+            Type *r = s->values[--s->value_count];
+            Type *a = s->values[--s->value_count];
+            value_push(s, a == t->arg && r == t->ret ? t : new_fun(s, a, r));
+        }
     }
-    else if (t->kind == TPRIM)
+    return s->values[--s->value_count];
+}
+
+// Copia o tipo do esquema trocando cada variável genérica por uma nova
+static Type *instantiate(SemanticState *s, TypeScheme *sch)
+{
+    if (sch->var_count == 0)
+        return sch->type;
+    for (int i = 0; i < sch->var_count; i++)
+        sch->vars[i]->copy = new_type_var(s);
+    Type *inst = copy_type(s, sch->type);
+    for (int i = 0; i < sch->var_count; i++)
+        sch->vars[i]->copy = NULL;
+    return inst;
+}
+
+// Tipo de uma variável no ambiente atual (instanciado)
+static Type *infer_variable(SemanticState *s, Atom name, unsigned int line)
+{
+    TypeScheme *sch = env_lookup(s, name);
+    if (!sch)
     {
-        return new_prim(t->prim);
-    }
-    else
-    { // TFUN
-        Type *a = copy_type(t->arg, map);
-        Type *r = copy_type(t->ret, map);
-        return new_fun(a, r);
+        diagnostics_fatal(s->diagnostics, (int)line, 0, "Erro: variável '%s' não declarada na linha %u.",
+                          atom_name(s->atoms, name), line);
     }
+    return instantiate(s, sch);
 }
 
-static Type *instantiate(TypeScheme *sch)
+/*
+ * Restrição de valor: uma declaração só é generalizada quando o valor
+ * inicial é um valor sintático (literal ou variável), cuja avaliação não
+ * pode fixar um tipo depois. Sem valor inicial a variável fica monomórfica
+ * no nível atual, e os usos seguintes decidem o seu tipo.
+ */
+static int declaration_generalizes(const ASTNode *node)
 {
-    int max = next_type_var;
-    Type **map = calloc(max, sizeof(Type *));
-    for (int i = 0; i < sch->var_count; i++)
+    const ASTNode *expression = node->variable_declaration.expression;
+    if (!expression)
+        return 0;
+    return expression->type == AST_NUMBER || expression->type == AST_STRING ||
+           expression->type == AST_VARIABLE;
+}
+
+/*
+ * Gancho pre da inferência: empilha o estado do nó e faz o trabalho que
+ * precede a inferência dos seus filhos.
+ */
+static ASTVisitResult infer_enter(void *context, const ASTVisit *visit)
+{
+    SemanticState *s = context;
+    ASTNode *node = visit->node;
+    s->frames = semantic_reserve(s->frames, s->frame_count, &s->frame_capacity, sizeof(InferFrame));
+    InferFrame *frame = &s->frames[s->frame_count++];
+    frame->values = s->value_count;
+    frame->type = NULL;
+
+    switch (node->type)
     {
-        map[sch->vars[i]] = new_type_var();
+    case AST_VARIABLE_DECLARATION:
+        if (declaration_generalizes(node))
+            s->level++;
+        frame->type = new_type_var(s);
+        break;
+    case AST_BLOCK:
+        // Corpos de if, while e função: as declarações valem até o fim do bloco
+        frame->scope = env_enter(s);
+        break;
+    case AST_FUNCTION_DECLARATION:
+    {
+        // Parâmetros, retorno e o próprio nome (para recursão) são
+        // monomórficos dentro do corpo; a função só é generalizada depois,
+        // já no escopo em que foi declarada
+        frame->scope = env_enter(s);
+        s->level++;
+        int n = node->function_declaration.param_count;
+        Type **params = semantic_alloc(s, n * sizeof(Type *));
+        for (int i = 0; i < n; i++)
+        {
+            params[i] = new_type_var(s);
+            env_add(s, node->function_declaration.parameters[i]->function_parameter.name, monomorphic(s, params[i]));
+        }
+        Type *ret_t = new_type_var(s);
+        Type *fun_t = ret_t;
+        for (int i = n - 1; i >= 0; i--)
+            fun_t = new_fun(s, params[i], fun_t);
+        // Sem parâmetros a função recebe nil, como a chamada sem argumentos
+        if (n == 0)
+            fun_t = new_fun(s, new_prim(TYPE_NIL), ret_t);
+        semantic_release(s, params, n * sizeof(Type *));
+        env_add(s, node->function_declaration.name, monomorphic(s, fun_t));
+
+        frame->type = fun_t;
+        frame->outer_return = s->return_type;
+        frame->outer_return_count = s->return_count;
+        s->return_type = ret_t;
+        s->return_count = 0;
+        break;
     }
-    Type *inst = copy_type(sch->type, map);
-    free(map);
-    return inst;
+    case AST_FUNCTION_CALL:
+        frame->type = infer_variable(s, node->function_call.function_name, node->line);
+        break;
+    default:
+        break;
+    }
+    return AST_VISIT_CONTINUE;
 }
 
-static Type *infer(ASTNode *node)
+/*
+ * Gancho post da inferência: conclui um nó cujos filhos já foram
+ * inferidos. Os tipos deles estão na pilha de valores a partir de
+ * frame->values (um por filho presente, na ordem de ast_child) e são
+ * substituídos pelo tipo do nó.
+ */
+static ASTVisitResult infer_leave(void *context, const ASTVisit *visit)
 {
+    SemanticState *s = context;
+    ASTNode *node = visit->node;
+    InferFrame *frame = &s->frames[--s->frame_count];
+    // Válido enquanto nada é empilhado em values (infer_variable empilha
+    // ao instanciar, então os filhos são lidos antes dela)
+    Type **children = s->values + frame->values;
+    Type *res;
+
     switch (node->type)
     {
     case AST_NUMBER:
-    {
-        Type *res = new_prim(TYPE_NUMBER);
+        res = new_prim(TYPE_NUMBER);
         node->data_type = type_to_datatype(res);
-        return res;
-    }
+        break;
     case AST_STRING:
-    {
-        Type *res = new_prim(TYPE_STRING);
+        res = new_prim(TYPE_STRING);
         node->data_type = type_to_datatype(res);
-        return res;
-    }
+        break;
     case AST_VARIABLE:
-    {
-        TypeScheme *sch = env_lookup(node->variable.name);
-        if (!sch)
-        {
-            fprintf(stderr, "Erro: variável '%s' não declarada.\n", node->variable.name);
-            exit(1);
-        }
-        Type *res = instantiate(sch);
+        res = infer_variable(s, node->variable.name, node->line);
         node->data_type = type_to_datatype(res);
-        return res;
-    }
+        break;
     case AST_BINARY_OP:
     {
-        Type *l = infer(node->binary_op.left);
-        Type *r = infer(node->binary_op.right);
-        const char *op = node->binary_op.operator;
-        if (!strcmp(op, "+") || !strcmp(op, "-") || !strcmp(op, "*") || !strcmp(op, "/"))
+        Type *l = children[0];
+        Type *r = children[1];
+        const OpTypeRule *rule = &op_type_rules[node->binary_op.op];
+        if (rule->operand != TYPE_UNKNOWN)
         {
-            unify(l, new_prim(TYPE_NUMBER));
-            unify(r, new_prim(TYPE_NUMBER));
-            return new_prim(TYPE_NUMBER);
+            unify(s, l, new_prim(rule->operand), node->line);
+            unify(s, r, new_prim(rule->operand), node->line);
         }
         else
         {
-            unify(l, r);
-            return new_prim(TYPE_BOOLEAN);
+            unify(s, l, r, node->line);
         }
+        res = rule->result != TYPE_UNKNOWN ? new_prim(rule->result) : l;
+        node->data_type = type_to_datatype(res);
+        break;
     }
-    case AST_VARIABLE_DECLARATION:
+    case AST_UNARY_OP:
     {
-        Type *t = new_type_var();
-        if (node->variable_declaration.expression)
+        Type *operand = children[0];
+        const OpTypeRule *rule = &op_type_rules[node->unary_op.op];
+        if (rule->operand != TYPE_UNKNOWN)
         {
-            Type *et = infer(node->variable_declaration.expression);
-            unify(t, et);
+            unify(s, operand, new_prim(rule->operand), node->line);
         }
-        env_add(node->variable_declaration.name, generalize(t));
-        return t;
+        res = rule->result != TYPE_UNKNOWN ? new_prim(rule->result) : operand;
+        node->data_type = type_to_datatype(res);
+        break;
     }
+    case AST_VARIABLE_DECLARATION:
+        res = frame->type;
+        if (node->variable_declaration.expression)
+            unify(s, res, children[0], node->line);
+        if (declaration_generalizes(node))
+        {
+            s->level--;
+            env_add(s, node->variable_declaration.name, generalize(s, res));
+        }
+        else
+        {
+            env_add(s, node->variable_declaration.name, monomorphic(s, res));
+        }
+        break;
     case AST_ASSIGNMENT:
     {
-        Type *et = infer(node->assignment.expression);
-        TypeScheme *sch = env_lookup(node->assignment.variable->variable.name);
-        Type *vt = instantiate(sch);
-        unify(vt, et);
-        return et;
+        // children[0] é o tipo da variável, já consultado no ambiente. Uma
+        // variável genérica não pode receber um valor: cada uso instancia o
+        // esquema, então o novo valor não restringiria os usos seguintes
+        Atom name = node->assignment.variable->variable.name;
+        if (env_lookup(s, name)->var_count > 0)
+        {
+            diagnostics_fatal(s->diagnostics, (int)node->line, 0,
+                              "Erro: atribuição à variável polimórfica '%s' na linha %u.",
+                              atom_name(s->atoms, name), node->line);
+        }
+        res = children[1];
+        unify(s, children[0], res, node->line);
+        break;
     }
     case AST_BLOCK:
-    {
-        Type *last = NULL;
-        for (int i = 0; i < node->block.statement_count; i++)
-            last = infer(node->block.statements[i]);
-        return last ? last : new_prim(TYPE_NIL);
-    }
+        // Comandos não produzem valor: o tipo de um return é tratado em
+        // AST_RETURN_STATEMENT, e o bloco tem tipo nil
+        env_leave(s, frame->scope);
+        res = new_prim(TYPE_NIL);
+        break;
     case AST_IF_STATEMENT:
-    {
-        Type *cond = infer(node->if_statement.condition);
-        unify(cond, new_prim(TYPE_BOOLEAN));
-        Type *t1 = infer(node->if_statement.then_branch);
-        Type *t2 = node->if_statement.else_branch ? infer(node->if_statement.else_branch) : new_prim(TYPE_NIL);
-        unify(t1, t2);
-        return t1;
-    }
     case AST_WHILE_STATEMENT:
-        unify(infer(node->while_statement.condition), new_prim(TYPE_BOOLEAN));
-        infer(node->while_statement.body);
-        return new_prim(TYPE_NIL);
+        unify(s, children[0], new_prim(TYPE_BOOLEAN), node->line);
+        res = new_prim(TYPE_NIL);
+        break;
     case AST_FUNCTION_DECLARATION:
-    {
-        int n = node->function_declaration.param_count;
-        Type **params = malloc(n * sizeof(Type *));
-        for (int i = 0; i < n; i++)
+        if (s->return_count == 0)
+            unify(s, s->return_type, new_prim(TYPE_NIL), node->line);
+        s->return_type = frame->outer_return;
+        s->return_count = frame->outer_return_count;
+        s->level--;
+        env_leave(s, frame->scope);
+
+        res = frame->type;
+        env_add(s, node->function_declaration.name, generalize(s, res));
+        node->data_type = TYPE_FUNCTION;
+        break;
+    case AST_RETURN_STATEMENT:
+        res = node->return_statement.expression ? children[0] : new_prim(TYPE_NIL);
+        if (!s->return_type)
         {
-            params[i] = new_type_var();
-            env_add(node->function_declaration.parameters[i]->function_parameter.name, generalize(params[i]));
+            diagnostics_fatal(s->diagnostics, (int)node->line, 0,
+                              "Erro: 'return' fora de uma função na linha %u.", node->line);
         }
-        Type *body_t = infer(node->function_declaration.body);
-        Type *fun_t = body_t;
-        for (int i = n - 1; i >= 0; i--)
-            fun_t = new_fun(params[i], fun_t);
-        env_add(node->function_declaration.name, generalize(fun_t));
-        return fun_t;
-    }
+        unify(s, s->return_type, res, node->line);
+        s->return_count++;
+        break;
     case AST_FUNCTION_CALL:
-    {
-        ASTNode fn_node = {0};
-        fn_node.type = AST_VARIABLE;
-        strncpy(fn_node.variable.name, node->function_call.function_name, MAX_TOKEN_LEN);
-        Type *ft = infer(&fn_node);
+        // Os argumentos são os únicos filhos da chamada
+        res = frame->type;
         for (int i = 0; i < node->function_call.arg_count; i++)
         {
-            Type *arg_t = infer(node->function_call.arguments[i]);
-            Type *res = new_type_var();
-            unify(ft, new_fun(arg_t, res));
-            ft = res;
+            Type *ret = new_type_var(s);
+            unify(s, res, new_fun(s, children[i], ret), node->line);
+            res = ret;
         }
-        return ft;
-    }
+        if (node->function_call.arg_count == 0)
+        {
+            // f() passa nil: o chamado precisa ser uma função, como nas
+            // declarações sem parâmetros
+            Type *ret = new_type_var(s);
+            unify(s, res, new_fun(s, new_prim(TYPE_NIL), ret), node->line);
+            res = ret;
+        }
+        node->data_type = type_to_datatype(res);
+        break;
     default:
-        return new_prim(TYPE_UNKNOWN);
+        res = new_prim(TYPE_UNKNOWN);
+        break;
+    }
+
+    s->value_count = frame->values;
+    value_push(s, res);
+    return AST_VISIT_CONTINUE;
+}
+
+/*
+ * Infere o tipo de root em pós-ordem com o percurso genérico da AST: cada
+ * nó é preparado em infer_enter, seus filhos são inferidos um a um e ele é
+ * concluído em infer_leave.
+ */
+static Type *infer(SemanticState *s, ASTNode *root)
+{
+    ASTVisitor visitor = {infer_enter, infer_leave, s};
+    ast_walk(root, &visitor, 1, &s->walk);
+    return s->values[--s->value_count];
+}
+
+/*
+ * Copia t para a arena de tipos atual durante uma coleta (ver
+ * semantic_collect). O tipo antigo guarda a sua cópia em copy, então tipos
+ * compartilhados são copiados uma única vez; variáveis ligadas dão lugar ao
+ * tipo a que foram ligadas. Usa a mesma pilha em pós-ordem de copy_type.
+ */
+static Type *collect_type(SemanticState *s, Type *t)
+{
+    size_t base = s->pair_count;
+    pair_push(s, t, NULL);
+    while (s->pair_count > base)
+    {
+        TypePair pair = s->pairs[--s->pair_count];
+        if (pair.a)
+        {
+            t = prune(pair.a);
+            if (t->kind == TPRIM)
+            {
+                value_push(s, t);
+            }
+            else if (t->copy)
+            {
+                value_push(s, t->copy);
+            }
+            else if (t->kind == TVAR)
+            {
+                Type *v = semantic_alloc(s, sizeof(Type));
+                *v = *t;
+                v->rank = 0;
+                v->parent = NULL;
+                v->copy = NULL;
+                t->copy = v;
+                value_push(s, v);
+            }
+            else
+            {
+                pair_push(s, NULL, t);
+                pair_push(s, t->ret, NULL);
+                pair_push(s, t->arg, NULL);
+            }
+        }
+        else
+        {
+            t = pair.b;
+            Type *r = s->values[--s->value_count];
+            Type *a = s->values[--s->value_count];
+            t->copy = new_fun(s, a, r);
+            value_push(s, t->copy);
+        }
+    }
+    return s->values[--s->value_count];
+}
+
+static TypeScheme *collect_scheme(SemanticState *s, const TypeScheme *sch)
+{
+    TypeScheme *copy = semantic_alloc(s, sizeof(TypeScheme));
+    copy->type = collect_type(s, sch->type);
+    copy->var_count = sch->var_count;
+    copy->vars = NULL;
+    if (sch->var_count)
+    {
+        copy->vars = semantic_alloc(s, sch->var_count * sizeof(Type *));
+        for (int i = 0; i < sch->var_count; i++)
+            copy->vars[i] = collect_type(s, sch->vars[i]);
     }
+    return copy;
 }
 
-void semantic_check(ASTNode *root)
+/*
+ * Entre comandos de nível superior só os esquemas visíveis em bindings
+ * ainda são alcançáveis: uma ligação escondida por outra declaração do
+ * mesmo nome nunca volta a valer, e os tipos intermediários dos comandos já
+ * verificados não são mais usados. Os esquemas visíveis são copiados para
+ * uma arena nova e a antiga é liberada inteira, junto com a tabela de
+ * funções compartilhadas, que é refeita pelas cópias.
+ */
+static void semantic_collect(SemanticState *s)
 {
-    env = NULL;
-    next_type_var = 0;
-    infer(root);
+    Arena old = s->types;
+    Type **old_fun_types = s->fun_types;
+    arena_init(&s->types, 0);
+    memset(s->free_blocks, 0, sizeof(s->free_blocks));
+    s->fun_types = NULL;
+    s->fun_count = 0;
+    s->fun_capacity = 0;
+
+    // O valor de cada posição ocupada é trocado no lugar, sem mudar a tabela
+    if (s->bindings.slots)
+    {
+        for (unsigned int i = 0; i <= s->bindings.mask; i++)
+        {
+            Symbol *slot = &s->bindings.slots[i];
+            if (slot->distance)
+                slot->value = collect_scheme(s, slot->value);
+        }
+    }
+
+    arena_release(&old);
+    free(old_fun_types);
+    s->types_live = s->types.bytes_allocated;
+}
+
+void semantic_begin(SemanticState *s, const AtomTable *atoms, Diagnostics *diagnostics)
+{
+    symbol_table_init(&s->bindings, NULL);
+    s->undo = NULL;
+    s->undo_count = 0;
+    s->undo_capacity = 0;
+    arena_init(&s->types, 0);
+    memset(s->free_blocks, 0, sizeof(s->free_blocks));
+    s->types_live = 0;
+    s->next_type_var = 0;
+    s->level = 0;
+    s->fun_types = NULL;
+    s->fun_count = 0;
+    s->fun_capacity = 0;
+    s->return_type = NULL;
+    s->return_count = 0;
+    s->walk.frames = NULL;
+    s->walk.count = s->walk.capacity = 0;
+    s->frames = NULL;
+    s->frame_count = s->frame_capacity = 0;
+    s->values = NULL;
+    s->value_count = s->value_capacity = 0;
+    s->pairs = NULL;
+    s->pair_count = s->pair_capacity = 0;
+    s->atoms = atoms;
+    s->diagnostics = diagnostics;
+}
+
+void semantic_declare_builtin(SemanticState *s, Atom name, int arity)
+{
+    // a1 -> a2 -> ... -> nil (nil -> nil sem argumentos), com as variáveis generalizadas
+    s->level++;
+    Type *t = new_prim(TYPE_NIL);
+    for (int i = 0; i < arity; i++)
+        t = new_fun(s, new_type_var(s), t);
+    if (arity == 0)
+        t = new_fun(s, new_prim(TYPE_NIL), t);
+    s->level--;
+    env_add(s, name, generalize(s, t));
+}
+
+void semantic_check_toplevel(SemanticState *s, ASTNode *statement)
+{
+    // Um erro anterior pode ter deixado as pilhas pela metade
+    s->walk.count = 0;
+    s->frame_count = 0;
+    s->value_count = 0;
+    s->pair_count = 0;
+    // Declarações de nível superior nunca são desfeitas: as ligações que
+    // elas escondem não voltam a ser visíveis
+    s->undo_count = 0;
+    infer(s, statement);
+
+    // Coleta quando a arena dobrou desde a anterior: custo constante por byte
+    if (s->types.bytes_allocated >= SEMANTIC_COLLECT_MIN_BYTES &&
+        s->types.bytes_allocated / 2 > s->types_live)
+        semantic_collect(s);
+}
+
+void semantic_free(SemanticState *s)
+{
+    symbol_table_free(&s->bindings);
+    free(s->undo);
+    s->undo = NULL;
+    s->undo_count = 0;
+    s->undo_capacity = 0;
+    arena_release(&s->types);
+    memset(s->free_blocks, 0, sizeof(s->free_blocks));
+
+    ast_walk_stack_free(&s->walk);
+    free(s->frames);
+    free(s->values);
+    free(s->pairs);
+    s->frames = NULL;
+    s->values = NULL;
+    s->pairs = NULL;
+    s->frame_count = s->frame_capacity = 0;
+    s->value_count = s->value_capacity = 0;
+    s->pair_count = s->pair_capacity = 0;
+
+    free(s->fun_types);
+    s->fun_types = NULL;
+    s->fun_count = 0;
+    s->fun_capacity = 0;
 }
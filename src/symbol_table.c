@@ -1,82 +1,148 @@
-#include <stdlib.h>
-#include <string.h>
+#include "symbol_table.h"
 #include <stdio.h>
+#include <stdlib.h>
 
-#include "symbol_table.h"
-#include "ast.h"
+#define SYMBOL_TABLE_INITIAL_BITS 4
 
-unsigned int symbol_hash(const char *name, int size) {
-    unsigned int hash = 0;
-    for (; *name; name++) {
-        hash = (hash << 2) + *name;
-    }
-    return hash % size;
+// Hash multiplicativo (Fibonacci): usa os bits altos do produto
+static unsigned int symbol_slot(const SymbolTable *table, Atom name) {
+    return (name * 2654435769u) >> table->shift;
+}
+
+void symbol_table_init(SymbolTable *table, SymbolTable *parent) {
+    table->slots = NULL;
+    table->count = 0;
+    table->mask = 0;
+    table->shift = 32;
+    table->parent = parent;
 }
 
+void symbol_table_free(SymbolTable *table) {
+    free(table->slots);
+    table->slots = NULL;
+    table->count = 0;
+    table->mask = 0;
+    table->shift = 32;
+}
 
-Symbol *symbol_table_lookup(SymbolTable *table, const char *name) {
-    unsigned int index = symbol_hash(name, table->size);
-    Symbol *symbol = table->symbols[index];
-    while (symbol) {
-        if (strcmp(symbol->name, name) == 0) {
-            return symbol;
+// Coloca um símbolo que ainda não está na tabela, deslocando os mais próximos da posição ideal
+static void symbol_place(SymbolTable *table, Symbol entry) {
+    unsigned int i = symbol_slot(table, entry.name);
+    entry.distance = 1;
+    for (;;) {
+        Symbol *slot = &table->slots[i];
+        if (slot->distance == 0) {
+            *slot = entry;
+            return;
         }
-        symbol = symbol->next;
-    }
-    if (table->parent) {
-        return symbol_table_lookup(table->parent, name);
+        if (slot->distance < entry.distance) {
+            Symbol displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+        }
+        entry.distance++;
+        i = (i + 1) & table->mask;
     }
-    return NULL;
 }
 
+// Aloca (ou dobra) as posições, reinserindo os símbolos existentes
+static void symbol_table_grow(SymbolTable *table) {
+    Symbol *old = table->slots;
+    unsigned int old_size = old ? table->mask + 1 : 0;
+    unsigned int bits = 32 - table->shift;
+    bits = old ? bits + 1 : SYMBOL_TABLE_INITIAL_BITS;
 
-void symbol_table_insert(SymbolTable *table, const char *name, DataType type) {
-    unsigned int index = symbol_hash(name, table->size);
-    Symbol *symbol = malloc(sizeof(Symbol));
-    if (!symbol) {
+    table->slots = calloc((size_t)1 << bits, sizeof(Symbol));
+    if (!table->slots) {
         perror("Erro de alocação de memória");
         exit(EXIT_FAILURE);
     }
-    strncpy(symbol->name, name, MAX_TOKEN_LEN);
-    symbol->type = type;
-    symbol->next = table->symbols[index];
-    table->symbols[index] = symbol;
+    table->mask = (1u << bits) - 1;
+    table->shift = 32 - bits;
+    for (unsigned int i = 0; i < old_size; i++) {
+        if (old[i].distance != 0) {
+            symbol_place(table, old[i]);
+        }
+    }
+    free(old);
 }
 
-
-SymbolTable *symbol_table_create(SymbolTable *parent) {
-    SymbolTable *table = malloc(sizeof(SymbolTable));
-    if (!table) {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
+/*
+ * Posição de name na tabela ou -1. Pelo invariante Robin Hood, name estaria
+ * antes de qualquer símbolo mais perto da própria posição ideal; posições
+ * vazias têm distância 0 e encerram a busca pelo mesmo teste.
+ */
+static inline long symbol_find(const SymbolTable *table, Atom name) {
+    if (table->count == 0) {
+        return -1;
     }
-    table->size = 211; 
-    table->symbols = calloc(table->size, sizeof(Symbol *));
-    if (!table->symbols) {
-        perror("Erro de alocação de memória");
-        exit(EXIT_FAILURE);
+    unsigned int i = symbol_slot(table, name);
+    for (unsigned int distance = 1;; distance++) {
+        const Symbol *slot = &table->slots[i];
+        if (slot->name == name) {
+            return (long)i;
+        }
+        if (slot->distance < distance) {
+            return -1;
+        }
+        i = (i + 1) & table->mask;
     }
-    table->parent = parent;
-    return table;
 }
 
+void *symbol_table_insert(SymbolTable *table, Atom name, void *value) {
+    long found = symbol_find(table, name);
+    if (found >= 0) {
+        void *old = table->slots[found].value;
+        table->slots[found].value = value;
+        return old;
+    }
+    // Carga máxima de 7/8
+    if (!table->slots || (table->count + 1) * 8 > (table->mask + 1) * 7) {
+        symbol_table_grow(table);
+    }
+    Symbol entry = { name, 1, value };
+    symbol_place(table, entry);
+    table->count++;
+    return NULL;
+}
 
+void *symbol_table_remove(SymbolTable *table, Atom name) {
+    long found = symbol_find(table, name);
+    if (found < 0) {
+        return NULL;
+    }
+    unsigned int i = (unsigned int)found;
+    void *value = table->slots[i].value;
 
+    // Remoção com deslocamento para trás: não deixa marcas de posição removida
+    for (;;) {
+        unsigned int next = (i + 1) & table->mask;
+        Symbol *slot = &table->slots[next];
+        if (slot->distance <= 1) {
+            break;
+        }
+        table->slots[i] = *slot;
+        table->slots[i].distance--;
+        i = next;
+    }
+    table->slots[i].name = ATOM_NONE;
+    table->slots[i].distance = 0;
+    table->slots[i].value = NULL;
+    table->count--;
+    return value;
+}
 
-SymbolTable *symbol_table_enter_scope(SymbolTable *parent) {
-    return symbol_table_create(parent);
+void *symbol_table_lookup_local(const SymbolTable *table, Atom name) {
+    long found = symbol_find(table, name);
+    return found >= 0 ? table->slots[found].value : NULL;
 }
 
-void symbol_table_exit_scope(SymbolTable *table) {
-    for (int i = 0; i < table->size; i++) {
-        Symbol *symbol = table->symbols[i];
-        while (symbol) {
-            Symbol *temp = symbol;
-            symbol = symbol->next;
-            free(temp);
+void *symbol_table_lookup(const SymbolTable *table, Atom name) {
+    for (; table; table = table->parent) {
+        long found = symbol_find(table, name);
+        if (found >= 0) {
+            return table->slots[found].value;
         }
     }
-    free(table->symbols);
-    free(table);
+    return NULL;
 }
-
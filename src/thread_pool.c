@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Faixa de índices ainda não iniciados de uma thread
+typedef struct {
+    pthread_mutex_t lock;
+    size_t next;
+    size_t end;
+} WorkRange;
+
+typedef struct {
+    WorkRange *ranges;
+    size_t thread_count;
+    ThreadPoolTask task;
+    void *context;
+} ThreadPool;
+
+typedef struct {
+    ThreadPool *pool;
+    size_t id;
+} Worker;
+
+// Retira o próximo índice da própria faixa
+static int range_pop(WorkRange *range, size_t *index) {
+    int found = 0;
+    pthread_mutex_lock(&range->lock);
+    if (range->next < range->end) {
+        *index = range->next++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+// Rouba a metade final da faixa de outra thread, devolvendo-a em thief
+static int range_steal(WorkRange *victim, WorkRange *thief) {
+    size_t begin = 0, end = 0;
+    pthread_mutex_lock(&victim->lock);
+    size_t available = victim->end - victim->next;
+    if (available > 0) {
+        size_t taken = (available + 1) / 2;
+        end = victim->end;
+        begin = end - taken;
+        victim->end = begin;
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    if (begin == end) {
+        return 0;
+    }
+    pthread_mutex_lock(&thief->lock);
+    thief->next = begin;
+    thief->end = end;
+    pthread_mutex_unlock(&thief->lock);
+    return 1;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    WorkRange *own = &pool->ranges[worker->id];
+
+    for (;;) {
+        size_t index;
+        while (range_pop(own, &index)) {
+            pool->task(pool->context, index);
+        }
+
+        // Procura trabalho nas outras threads, a partir da vizinha
+        int stolen = 0;
+        for (size_t k = 1; k < pool->thread_count && !stolen; k++) {
+            stolen = range_steal(&pool->ranges[(worker->id + k) % pool->thread_count], own);
+        }
+        if (!stolen) {
+            // Faixas só diminuem, então nada mais será criado
+            return NULL;
+        }
+    }
+}
+
+size_t thread_pool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+size_t thread_pool_run(size_t threads, size_t count, ThreadPoolTask task, void *context) {
+    if (threads == 0) {
+        threads = thread_pool_default_threads();
+    }
+    if (threads > count) {
+        threads = count > 0 ? count : 1;
+    }
+
+    if (threads == 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return 1;
+    }
+
+    ThreadPool pool;
+    pool.ranges = malloc(threads * sizeof(WorkRange));
+    Worker *workers = malloc(threads * sizeof(Worker));
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    if (!pool.ranges || !workers || !handles) {
+        free(pool.ranges);
+        free(workers);
+        free(handles);
+        for (size_t i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return 1;
+    }
+    pool.thread_count = threads;
+    pool.task = task;
+    pool.context = context;
+
+    for (size_t t = 0; t < threads; t++) {
+        pthread_mutex_init(&pool.ranges[t].lock, NULL);
+        pool.ranges[t].next = count * t / threads;
+        pool.ranges[t].end = count * (t + 1) / threads;
+        workers[t].pool = &pool;
+        workers[t].id = t;
+    }
+
+    // A thread que chama trabalha como worker 0
+    size_t started = 1;
+    for (size_t t = 1; t < threads; t++) {
+        if (pthread_create(&handles[t], NULL, worker_main, &workers[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+    worker_main(&workers[0]);
+    for (size_t t = 1; t < started; t++) {
+        pthread_join(handles[t], NULL);
+    }
+
+    for (size_t t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&pool.ranges[t].lock);
+    }
+    free(pool.ranges);
+    free(workers);
+    free(handles);
+    return started;
+}
@@ -0,0 +1,565 @@
+#include "vm.h"
+#include "builtins.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_COMPUTED_GOTO
+#endif
+
+#define VM_STRINGS_CHUNK_SIZE (64 * 1024)
+#define VM_CLOSURES_CHUNK_SIZE (64 * 1024)
+
+static void *vm_alloc(size_t count, size_t size) {
+    void *result = calloc(count ? count : 1, size);
+    if (!result) {
+        perror("Erro de alocação de memória");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static VMString *vm_new_string(VM *vm, size_t length) {
+    VMString *string = arena_alloc(&vm->strings, sizeof(VMString) + length + 1);
+    string->length = length;
+    string->chars[length] = '\0';
+    return string;
+}
+
+static VMClosure *vm_new_closure(VM *vm, unsigned int function, unsigned int upvalue_count) {
+    VMClosure *closure = arena_alloc(&vm->closures, sizeof(VMClosure) + upvalue_count * sizeof(VMUpvalue *));
+    closure->function = function;
+    closure->upvalue_count = upvalue_count;
+    return closure;
+}
+
+static VMValue vm_constant(VM *vm, const IRConstant *constant) {
+    VMValue value;
+    switch (constant->kind) {
+        case IR_CONST_NUMBER:
+            value.type = VM_NUMBER;
+            value.number = constant->number;
+            break;
+        case IR_CONST_STRING: {
+            size_t length = atom_length(vm->atoms, constant->string);
+            VMString *string = vm_new_string(vm, length);
+            memcpy(string->chars, atom_name(vm->atoms, constant->string), length);
+            value.type = VM_STRING;
+            value.string = string;
+            break;
+        }
+        case IR_CONST_FUNCTION:
+        default:
+            value.type = VM_FUNCTION;
+            value.closure = vm->functions[constant->function].closure;
+            break;
+    }
+    return value;
+}
+
+void vm_init(VM *vm, const IRProgram *program, const AtomTable *atoms, Diagnostics *diagnostics) {
+    vm->program = program;
+    vm->atoms = atoms;
+    vm->diagnostics = diagnostics;
+    vm->out = stdout;
+    arena_init(&vm->strings, VM_STRINGS_CHUNK_SIZE);
+    arena_init(&vm->closures, VM_CLOSURES_CHUNK_SIZE);
+    vm->open_upvalues = NULL;
+
+    // As closures vêm antes das constantes, que podem citar qualquer função
+    vm->functions = vm_alloc(program->function_count, sizeof(VMFunction));
+    for (size_t i = 0; i < program->function_count; i++) {
+        vm->functions[i].closure = vm_new_closure(vm, (unsigned int)i, 0);
+    }
+    for (size_t i = 0; i < program->function_count; i++) {
+        const IRFunction *source = &program->functions[i];
+        VMFunction *function = &vm->functions[i];
+        function->code = source->code;
+        function->lines = source->lines;
+        function->param_count = source->param_count;
+        function->register_count = source->register_count;
+        function->name = source->name;
+        function->upvalues = source->upvalues;
+        function->upvalue_count = source->upvalue_count;
+        function->constants = vm_alloc(source->constant_count, sizeof(VMValue));
+        for (unsigned int k = 0; k < source->constant_count; k++) {
+            function->constants[k] = vm_constant(vm, &source->constants[k]);
+        }
+    }
+
+    // VM_NIL é zero: as globais começam todas nil
+    vm->globals = vm_alloc(program->global_count, sizeof(VMValue));
+    for (unsigned int b = 0; b < BUILTIN_COUNT && b < program->global_count; b++) {
+        vm->globals[b].type = VM_BUILTIN;
+        vm->globals[b].function = b;
+    }
+
+    vm->stack = vm_alloc(VM_STACK_SIZE, sizeof(VMValue));
+    vm->calls = vm_alloc(VM_MAX_CALLS, sizeof(VMCallInfo));
+}
+
+void vm_free(VM *vm) {
+    for (size_t i = 0; i < vm->program->function_count; i++) {
+        free(vm->functions[i].constants);
+    }
+    free(vm->functions);
+    free(vm->globals);
+    free(vm->stack);
+    free(vm->calls);
+    arena_release(&vm->strings);
+    arena_release(&vm->closures);
+    vm->open_upvalues = NULL;
+    vm->functions = NULL;
+    vm->globals = NULL;
+    vm->stack = NULL;
+    vm->calls = NULL;
+}
+
+// Relata um erro de execução na linha da instrução em curso (pc já avançou)
+static int vm_error(VM *vm, const VMFunction *function, const IRInstruction *pc, const char *format, ...) {
+    unsigned int line = function->lines[pc - 1 - function->code];
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    diagnostics_report(vm->diagnostics, (int)line, 0, "Erro de execução: %s na linha %u.", message, line);
+    return 1;
+}
+
+// Só nil e false são falsos
+static int vm_truthy(const VMValue *value) {
+    return !(value->type == VM_NIL || (value->type == VM_BOOLEAN && !value->boolean));
+}
+
+static int vm_equal(const VMValue *a, const VMValue *b) {
+    if (a->type != b->type) {
+        return 0;
+    }
+    switch (a->type) {
+        case VM_NIL:
+            return 1;
+        case VM_BOOLEAN:
+            return !a->boolean == !b->boolean;
+        case VM_NUMBER:
+            return a->number == b->number;
+        case VM_STRING:
+            return a->string == b->string ||
+                   (a->string->length == b->string->length &&
+                    memcmp(a->string->chars, b->string->chars, a->string->length) == 0);
+        case VM_FUNCTION:
+            return a->closure == b->closure;
+        case VM_BUILTIN:
+            return a->function == b->function;
+    }
+    return 0;
+}
+
+// Ordem entre strings: bytes, e a mais curta antes quando uma é prefixo da outra
+static int vm_string_compare(const VMString *a, const VMString *b) {
+    size_t length = a->length < b->length ? a->length : b->length;
+    int result = memcmp(a->chars, b->chars, length);
+    if (result != 0) {
+        return result;
+    }
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+static const char *vm_type_name(VMValueType type) {
+    switch (type) {
+        case VM_NIL:
+            return "nil";
+        case VM_BOOLEAN:
+            return "boolean";
+        case VM_NUMBER:
+            return "number";
+        case VM_STRING:
+            return "string";
+        case VM_FUNCTION:
+        case VM_BUILTIN:
+            return "function";
+    }
+    return "?";
+}
+
+// Relata um operando de aritmética ou concatenação que não tem o tipo esperado
+static int vm_operand_error(VM *vm, const VMFunction *function, const IRInstruction *pc, const char *operation,
+                            const VMValue *b, const VMValue *c, VMValueType expected) {
+    const VMValue *bad = b->type != expected ? b : c;
+    return vm_error(vm, function, pc, "%s com um valor %s", operation, vm_type_name(bad->type));
+}
+
+static void vm_print_value(VM *vm, const VMValue *value) {
+    switch (value->type) {
+        case VM_NIL:
+            fputs("nil", vm->out);
+            break;
+        case VM_BOOLEAN:
+            fputs(value->boolean ? "true" : "false", vm->out);
+            break;
+        case VM_NUMBER:
+            fprintf(vm->out, "%.14g", value->number);
+            break;
+        case VM_STRING:
+            fwrite(value->string->chars, 1, value->string->length, vm->out);
+            break;
+        case VM_FUNCTION:
+            fprintf(vm->out, "function: %s", atom_name(vm->atoms, vm->functions[value->closure->function].name));
+            break;
+        case VM_BUILTIN:
+            fprintf(vm->out, "builtin: %s", builtin_name((Builtin)value->function));
+            break;
+    }
+}
+
+// Executa uma função predefinida com os argumentos em args; o resultado vai para result
+static void vm_builtin(VM *vm, Builtin builtin, const VMValue *args, VMValue *result) {
+    switch (builtin) {
+        case BUILTIN_PRINT:
+            vm_print_value(vm, &args[0]);
+            fputc('\n', vm->out);
+            break;
+        case BUILTIN_COUNT:
+            break;
+    }
+    result->type = VM_NIL;
+}
+
+// Upvalue aberto do registrador slot, compartilhado por quem já o capturou
+static VMUpvalue *vm_capture(VM *vm, VMValue *slot) {
+    VMUpvalue **link = &vm->open_upvalues;
+    while (*link && (*link)->value > slot) {
+        link = &(*link)->next;
+    }
+    if (*link && (*link)->value == slot) {
+        return *link;
+    }
+    VMUpvalue *upvalue = arena_alloc(&vm->closures, sizeof(VMUpvalue));
+    upvalue->value = slot;
+    upvalue->next = *link;
+    *link = upvalue;
+    return upvalue;
+}
+
+// Fecha os upvalues dos registradores de level em diante, que saem de escopo
+static void vm_close(VM *vm, VMValue *level) {
+    while (vm->open_upvalues && vm->open_upvalues->value >= level) {
+        VMUpvalue *upvalue = vm->open_upvalues;
+        upvalue->closed = *upvalue->value;
+        upvalue->value = &upvalue->closed;
+        vm->open_upvalues = upvalue->next;
+    }
+}
+
+int vm_run(VM *vm) {
+    VMValue *const stack_end = vm->stack + VM_STACK_SIZE;
+    VMCallInfo *const calls_end = vm->calls + VM_MAX_CALLS;
+    VMValue *globals = vm->globals;
+    VMCallInfo *ci = vm->calls;
+    const VMFunction *function = &vm->functions[0];
+    VMClosure *closure = function->closure;
+    const VMValue *k = function->constants;
+    const IRInstruction *pc = function->code;
+    VMValue *base = vm->stack;
+    IRInstruction i;
+
+    ci->base = base;
+    ci->closure = closure;
+    ci->pc = pc;
+
+#define RA (base[IR_A(i)])
+#define RB (base[IR_B(i)])
+#define RC (base[IR_C(i)])
+// Índice Bx, lendo a IR_EXTRAARG seguinte quando ele foi estendido
+#define VM_BX(bx) \
+    do { \
+        (bx) = IR_BX(i); \
+        if ((bx) == IR_BX_EXTENDED) { \
+            (bx) = IR_AX(*pc++); \
+        } \
+    } while (0)
+/*
+ * O verificador de tipos não garante o valor de uma variável declarada sem
+ * valor inicial (ela começa nil), então aritmética e concatenação conferem
+ * o tipo dos operandos como a comparação genérica.
+ */
+#define VM_EXPECT(type_, operation) \
+    do { \
+        if (RB.type != (type_) || RC.type != (type_)) { \
+            return vm_operand_error(vm, function, pc, (operation), &RB, &RC, (type_)); \
+        } \
+    } while (0)
+#define VM_SET_NUMBER(reg, value) \
+    do { \
+        double number_ = (value); \
+        (reg).type = VM_NUMBER; \
+        (reg).number = number_; \
+    } while (0)
+#define VM_SET_BOOLEAN(reg, value) \
+    do { \
+        int boolean_ = (value); \
+        (reg).type = VM_BOOLEAN; \
+        (reg).boolean = boolean_; \
+    } while (0)
+
+#ifdef VM_COMPUTED_GOTO
+    // Cada operação salta direto para a próxima, sem voltar a um laço central
+    static const void *const labels[IR_OPCODE_COUNT] = {
+        [IR_MOVE] = &&L_IR_MOVE,
+        [IR_LOADK] = &&L_IR_LOADK,
+        [IR_LOADNIL] = &&L_IR_LOADNIL,
+        [IR_GETGLOBAL] = &&L_IR_GETGLOBAL,
+        [IR_SETGLOBAL] = &&L_IR_SETGLOBAL,
+        [IR_ADD] = &&L_IR_ADD,
+        [IR_SUB] = &&L_IR_SUB,
+        [IR_MUL] = &&L_IR_MUL,
+        [IR_DIV] = &&L_IR_DIV,
+        [IR_MOD] = &&L_IR_MOD,
+        [IR_POW] = &&L_IR_POW,
+        [IR_CONCAT] = &&L_IR_CONCAT,
+        [IR_EQ] = &&L_IR_EQ,
+        [IR_NE] = &&L_IR_NE,
+        [IR_LT] = &&L_IR_LT,
+        [IR_LE] = &&L_IR_LE,
+        [IR_LTN] = &&L_IR_LTN,
+        [IR_LEN] = &&L_IR_LEN,
+        [IR_NOT] = &&L_IR_NOT,
+        [IR_NEG] = &&L_IR_NEG,
+        [IR_TEST] = &&L_IR_TEST,
+        [IR_JMP] = &&L_IR_JMP,
+        [IR_CALL] = &&L_IR_CALL,
+        [IR_RETURN] = &&L_IR_RETURN,
+        [IR_EXTRAARG] = &&L_IR_EXTRAARG,
+        [IR_GETUPVAL] = &&L_IR_GETUPVAL,
+        [IR_SETUPVAL] = &&L_IR_SETUPVAL,
+        [IR_CLOSURE] = &&L_IR_CLOSURE,
+        [IR_CLOSE] = &&L_IR_CLOSE,
+    };
+#define VM_CASE(op) L_##op
+#define VM_NEXT() goto *labels[IR_OP(i = *pc++)]
+#else
+#define VM_CASE(op) case op
+#define VM_NEXT() goto dispatch
+#endif
+
+    VM_NEXT();
+#ifndef VM_COMPUTED_GOTO
+dispatch:
+    switch (IR_OP(i = *pc++)) {
+#endif
+    VM_CASE(IR_MOVE):
+        RA = RB;
+        VM_NEXT();
+    VM_CASE(IR_LOADK): {
+        unsigned int bx;
+        VM_BX(bx);
+        RA = k[bx];
+        VM_NEXT();
+    }
+    VM_CASE(IR_LOADNIL):
+        RA.type = VM_NIL;
+        VM_NEXT();
+    VM_CASE(IR_GETGLOBAL): {
+        unsigned int bx;
+        VM_BX(bx);
+        RA = globals[bx];
+        VM_NEXT();
+    }
+    VM_CASE(IR_SETGLOBAL): {
+        unsigned int bx;
+        VM_BX(bx);
+        globals[bx] = RA;
+        VM_NEXT();
+    }
+    VM_CASE(IR_GETUPVAL):
+        RA = *closure->upvalues[IR_B(i)]->value;
+        VM_NEXT();
+    VM_CASE(IR_SETUPVAL):
+        *closure->upvalues[IR_B(i)]->value = RA;
+        VM_NEXT();
+    VM_CASE(IR_CLOSURE): {
+        unsigned int bx;
+        VM_BX(bx);
+        const VMFunction *source = &vm->functions[bx];
+        VMClosure *created = vm_new_closure(vm, bx, source->upvalue_count);
+        for (unsigned int u = 0; u < source->upvalue_count; u++) {
+            const IRUpvalue *upvalue = &source->upvalues[u];
+            created->upvalues[u] = upvalue->in_stack ? vm_capture(vm, base + upvalue->index)
+                                                     : closure->upvalues[upvalue->index];
+        }
+        RA.type = VM_FUNCTION;
+        RA.closure = created;
+        VM_NEXT();
+    }
+    VM_CASE(IR_CLOSE):
+        vm_close(vm, &RA);
+        VM_NEXT();
+    VM_CASE(IR_ADD):
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        VM_SET_NUMBER(RA, RB.number + RC.number);
+        VM_NEXT();
+    VM_CASE(IR_SUB):
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        VM_SET_NUMBER(RA, RB.number - RC.number);
+        VM_NEXT();
+    VM_CASE(IR_MUL):
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        VM_SET_NUMBER(RA, RB.number * RC.number);
+        VM_NEXT();
+    VM_CASE(IR_DIV):
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        VM_SET_NUMBER(RA, RB.number / RC.number);
+        VM_NEXT();
+    VM_CASE(IR_MOD): {
+        // Resto com o sinal do divisor, como em Lua
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        double b = RB.number, c = RC.number;
+        double m = fmod(b, c);
+        if (m != 0 && (m < 0) != (c < 0)) {
+            m += c;
+        }
+        VM_SET_NUMBER(RA, m);
+        VM_NEXT();
+    }
+    VM_CASE(IR_POW):
+        VM_EXPECT(VM_NUMBER, "aritmética");
+        VM_SET_NUMBER(RA, pow(RB.number, RC.number));
+        VM_NEXT();
+    VM_CASE(IR_CONCAT): {
+        VM_EXPECT(VM_STRING, "concatenação");
+        const VMString *b = RB.string, *c = RC.string;
+        VMString *string = vm_new_string(vm, b->length + c->length);
+        memcpy(string->chars, b->chars, b->length);
+        memcpy(string->chars + b->length, c->chars, c->length);
+        RA.type = VM_STRING;
+        RA.string = string;
+        VM_NEXT();
+    }
+    VM_CASE(IR_EQ):
+        VM_SET_BOOLEAN(RA, vm_equal(&RB, &RC));
+        VM_NEXT();
+    VM_CASE(IR_NE):
+        VM_SET_BOOLEAN(RA, !vm_equal(&RB, &RC));
+        VM_NEXT();
+    VM_CASE(IR_LT):
+    VM_CASE(IR_LE): {
+        const VMValue *b = &RB, *c = &RC;
+        int result;
+        if (b->type == VM_NUMBER && c->type == VM_NUMBER) {
+            result = IR_OP(i) == IR_LT ? b->number < c->number : b->number <= c->number;
+        } else if (b->type == VM_STRING && c->type == VM_STRING) {
+            int order = vm_string_compare(b->string, c->string);
+            result = IR_OP(i) == IR_LT ? order < 0 : order <= 0;
+        } else {
+            return vm_error(vm, function, pc, "comparação entre %s e %s", vm_type_name(b->type),
+                            vm_type_name(c->type));
+        }
+        VM_SET_BOOLEAN(RA, result);
+        VM_NEXT();
+    }
+    VM_CASE(IR_LTN):
+        VM_EXPECT(VM_NUMBER, "comparação");
+        VM_SET_BOOLEAN(RA, RB.number < RC.number);
+        VM_NEXT();
+    VM_CASE(IR_LEN):
+        VM_EXPECT(VM_NUMBER, "comparação");
+        VM_SET_BOOLEAN(RA, RB.number <= RC.number);
+        VM_NEXT();
+    VM_CASE(IR_NOT):
+        VM_SET_BOOLEAN(RA, !vm_truthy(&RB));
+        VM_NEXT();
+    VM_CASE(IR_NEG):
+        if (RB.type != VM_NUMBER) {
+            return vm_error(vm, function, pc, "aritmética com um valor %s", vm_type_name(RB.type));
+        }
+        VM_SET_NUMBER(RA, -RB.number);
+        VM_NEXT();
+    VM_CASE(IR_TEST):
+        // O IR_JMP seguinte é executado aqui mesmo, sem outro despacho
+        if (vm_truthy(&RA) == IR_C(i)) {
+            pc += IR_SJ(*pc) + 1;
+        } else {
+            pc++;
+        }
+        VM_NEXT();
+    VM_CASE(IR_JMP):
+        pc += IR_SJ(i);
+        VM_NEXT();
+    VM_CASE(IR_CALL): {
+        VMValue *callee = &RA;
+        int argc = IR_B(i);
+        if (callee->type == VM_BUILTIN) {
+            Builtin builtin = (Builtin)callee->function;
+            if (argc != builtin_arity(builtin)) {
+                return vm_error(vm, function, pc, "'%s' espera %d argumento(s), recebeu %d",
+                                builtin_name(builtin), builtin_arity(builtin), argc);
+            }
+            vm_builtin(vm, builtin, callee + 1, callee);
+            VM_NEXT();
+        }
+        if (callee->type != VM_FUNCTION) {
+            return vm_error(vm, function, pc, "chamada de um valor %s", vm_type_name(callee->type));
+        }
+        const VMFunction *target = &vm->functions[callee->closure->function];
+        if (argc != target->param_count) {
+            return vm_error(vm, function, pc, "'%s' espera %d argumento(s), recebeu %d",
+                            atom_name(vm->atoms, target->name), target->param_count, argc);
+        }
+        if (ci + 1 == calls_end || callee + 1 + target->register_count > stack_end) {
+            return vm_error(vm, function, pc, "estouro da pilha de chamadas");
+        }
+        // Os argumentos já estão nos primeiros registradores do novo quadro
+        ci->pc = pc;
+        ci++;
+        ci->base = base = callee + 1;
+        ci->closure = closure = callee->closure;
+        function = target;
+        k = function->constants;
+        pc = function->code;
+        VM_NEXT();
+    }
+    VM_CASE(IR_RETURN): {
+        VMValue result;
+        if (IR_B(i)) {
+            result = RA;
+        } else {
+            result.type = VM_NIL;
+        }
+        // As variáveis do quadro saem de escopo
+        if (vm->open_upvalues && vm->open_upvalues->value >= base) {
+            vm_close(vm, base);
+        }
+        if (ci == vm->calls) {
+            return 0;
+        }
+        // O resultado ocupa o registrador da função na chamadora
+        base[-1] = result;
+        ci--;
+        base = ci->base;
+        pc = ci->pc;
+        closure = ci->closure;
+        function = &vm->functions[closure->function];
+        k = function->constants;
+        VM_NEXT();
+    }
+    VM_CASE(IR_EXTRAARG):
+        // Consumida pela instrução anterior; nunca despachada
+        VM_NEXT();
+#ifndef VM_COMPUTED_GOTO
+    default:
+        return vm_error(vm, function, pc, "operação inválida %u", (unsigned int)IR_OP(i));
+    }
+#endif
+
+#undef RA
+#undef RB
+#undef RC
+#undef VM_BX
+#undef VM_EXPECT
+#undef VM_SET_NUMBER
+#undef VM_SET_BOOLEAN
+#undef VM_CASE
+#undef VM_NEXT
+}
@@ -0,0 +1,218 @@
+#!/bin/sh
+#
+# Testes de regressão do lunatico. Cada caso roda o executável sobre um
+# programa pequeno (ou gerado) e confere o código de saída e um trecho da
+# saída. Uso: tests/run.sh [executável]
+#
+
+LUNATICO=${1:-./lunatico}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+
+# check NOME STATUS TRECHO ARGS... — roda o lunatico com ARGS e exige o
+# código de saída STATUS e uma linha da saída contendo TRECHO (vazio aceita
+# qualquer saída)
+check() {
+    name=$1
+    expected_status=$2
+    expected_text=$3
+    shift 3
+    "$LUNATICO" "$@" > "$WORK/out" 2>&1
+    status=$?
+    if [ "$status" -ne "$expected_status" ]; then
+        echo "FALHOU: $name (saída $status, esperado $expected_status)"
+        tail -n 5 "$WORK/out"
+        failed=$((failed + 1))
+    elif [ -n "$expected_text" ] && ! grep -qF -- "$expected_text" "$WORK/out"; then
+        echo "FALHOU: $name (sem '$expected_text' na saída)"
+        tail -n 5 "$WORK/out"
+        failed=$((failed + 1))
+    else
+        passed=$((passed + 1))
+    fi
+}
+
+# Programa em $WORK/NOME.luna a partir da entrada padrão
+program() {
+    cat > "$WORK/$1.luna"
+}
+
+# Cadeia de 100000 'elseif': o parser não pode usar pilha proporcional a ela
+awk 'BEGIN {
+    n = 100000
+    print "local x = " (n - 2)
+    print "if x == 0 then print(0)"
+    for (i = 1; i < n; i++) print "elseif x == " i " then print(" i ")"
+    print "else print(-1) end"
+}' > "$WORK/elseif_chain.luna"
+check "cadeia longa de elseif (--repeat)" 0 "" --repeat 1 "$WORK/elseif_chain.luna"
+check "cadeia longa de elseif (--emit-ir)" 0 "" --emit-ir "$WORK/elseif_chain.luna"
+check "cadeia longa de elseif (run)" 0 "99998" run "$WORK/elseif_chain.luna"
+
+# 5000 'if' aninhados estão dentro do limite de aninhamento
+awk 'BEGIN {
+    n = 5000
+    print "local x = 1"
+    for (i = 0; i < n; i++) print "if x == 1 then"
+    print "print(\"fundo\")"
+    for (i = 0; i < n; i++) print "end"
+}' > "$WORK/nested_if.luna"
+check "5000 if aninhados (run)" 0 "fundo" run "$WORK/nested_if.luna"
+
+# Além do limite o programa é rejeitado com um erro, sem estourar a pilha
+awk 'BEGIN {
+    n = 20000
+    printf "print("
+    for (i = 0; i < n; i++) printf "("
+    printf "1"
+    for (i = 0; i < n; i++) printf ")"
+    print ")"
+}' > "$WORK/deep_parens.luna"
+check "aninhamento acima do limite" 1 "aninhamento excessivo" run "$WORK/deep_parens.luna"
+
+# Restrição de valor: 'local x' sem valor inicial não é genérico
+program uninitialized_local <<'EOF'
+local x
+local y = x .. "a"
+local z = x + 1
+EOF
+check "local sem valor inicial é monomórfico" 1 "incompatíveis" run "$WORK/uninitialized_local.luna"
+
+program polymorphic_assignment <<'EOF'
+function id(a) return a end
+function inc(a) return a + 1 end
+local g = id
+g = inc
+print(g("s"))
+EOF
+check "atribuição a variável polimórfica" 1 "polimórfica 'g'" run "$WORK/polymorphic_assignment.luna"
+
+program generic_alias <<'EOF'
+function id(a) return a end
+local g = id
+print(g(1))
+print(g("s"))
+EOF
+check "variável com valor sintático é genérica" 0 "s" run "$WORK/generic_alias.luna"
+
+# Operandos nil chegam à VM por variáveis anotadas e nunca atribuídas
+program nil_arithmetic <<'EOF'
+local x: number
+print(x + 1)
+EOF
+check "aritmética com nil" 1 "aritmética com um valor nil" run "$WORK/nil_arithmetic.luna"
+
+program nil_negation <<'EOF'
+local x: number
+print(-x)
+EOF
+check "negação de nil" 1 "aritmética com um valor nil" run "$WORK/nil_negation.luna"
+
+program nil_concat <<'EOF'
+local s: string
+local y = s .. "a"
+print(y)
+EOF
+check "concatenação com nil" 1 "concatenação com um valor nil" run "$WORK/nil_concat.luna"
+
+# Funções predefinidas também conferem o número de argumentos
+program builtin_arity <<'EOF'
+print("stale")
+print()
+EOF
+check "print sem argumentos" 1 "'print' espera 1 argumento(s), recebeu 0" run "$WORK/builtin_arity.luna"
+
+program zero_arity <<'EOF'
+function inc(a) return a + 1 end
+function make() return inc end
+local g = make()
+print(g(41))
+EOF
+check "função sem parâmetros que devolve uma função" 0 "42" run "$WORK/zero_arity.luna"
+
+# Funções aninhadas usam as variáveis locais das envolventes
+program closures <<'EOF'
+function counter()
+    local n = 0
+    function inc()
+        n = n + 1
+        return n
+    end
+    return inc
+end
+local a = counter()
+local b = counter()
+a()
+print(a() * 10 + b())
+function outer(x)
+    function middle()
+        function inner() return x .. "!" end
+        return inner()
+    end
+    return middle()
+end
+print(outer("oi"))
+function fact(n)
+    function go(k)
+        if k <= 1 then return 1 end
+        return k * go(k - 1)
+    end
+    return go(n)
+end
+print(fact(10))
+EOF
+check "closure com estado próprio" 0 "21" run "$WORK/closures.luna"
+check "upvalue repassado por função intermediária" 0 "oi!" run "$WORK/closures.luna"
+check "função aninhada recursiva" 0 "3628800" run "$WORK/closures.luna"
+check "closures na IR" 0 "GETUPVAL" --emit-ir "$WORK/closures.luna"
+
+# Cada execução do corpo do laço tem a sua própria variável
+program loop_closures <<'EOF'
+function last()
+    function none() return -1 end
+    local first = none
+    local i = 0
+    while i < 3 do
+        local v = i * 10
+        function get() return v end
+        if i == 0 then first = get end
+        i = i + 1
+    end
+    return first() + i * 100
+end
+print(last())
+EOF
+check "variável nova a cada volta do laço" 0 "300" run "$WORK/loop_closures.luna"
+
+# Declarações repetidas do mesmo nome: a arena de tipos acompanha as
+# ligações visíveis e não o número de comandos
+awk 'BEGIN {
+    print "function id(a) return a end"
+    print "local x"
+    for (i = 0; i < 100000; i++) {
+        print "function f(a, b) return a + b end"
+        print "local y = f(1, 2)"
+        print "local s = \"a\" .. \"b\""
+        print "function g(h) return h(1) end"
+    }
+    print "print(id(41) + 1)"
+    print "print(id(\"ok\"))"
+    print "x = 1"
+    print "print(x + 1)"
+}' > "$WORK/redeclarations.luna"
+check "ligações sobrevivem à coleta de tipos" 0 "ok" run "$WORK/redeclarations.luna"
+check "arena de tipos limitada" 0 "" --repeat 1 "$WORK/redeclarations.luna"
+type_bytes=$(sed -n 's/.*arena de tipos \([0-9]*\) bytes.*/\1/p' "$WORK/out")
+if [ -z "$type_bytes" ] || [ "$type_bytes" -gt 4194304 ]; then
+    echo "FALHOU: arena de tipos com ${type_bytes:-?} bytes após 400000 comandos"
+    passed=$((passed - 1))
+    failed=$((failed + 1))
+fi
+echo 'local z = x .. "a"' >> "$WORK/redeclarations.luna"
+check "variável monomórfica continua ligada após a coleta" 1 "incompatíveis" run "$WORK/redeclarations.luna"
+
+echo "Testes: $passed ok, $failed com falha"
+[ "$failed" -eq 0 ]